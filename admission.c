@@ -0,0 +1,478 @@
+/* Implementation of the admission of waiting processes into memory */
+/* for comments on the functions see the associated .h-file */
+
+/* ---------------------------------------------------------------- */
+/* Include required external definitions */
+#include "globals.h"
+#include "admission.h"
+#include "numa.h"
+#include "quickfit.h"
+#include "checkpoint.h"
+
+/* data type of a hole of the free list while a round packs processes */
+typedef struct
+	{
+		unsigned start;
+		unsigned size;				// 0 once it is used up
+		unsigned node;
+	} Hole_t;
+
+/* ----------------------------------------------------------------	*/
+/* Declarations of global variables visible only in this file 		*/
+AdmissionPolicy_t admissionPolicy = admissionFifo;
+unsigned admissionWindow = ADMISSION_DEFAULT_WINDOW;
+unsigned maxAdmissionDelay = ADMISSION_DEFAULT_MAX_DELAY;
+unsigned ownerQuota[MAX_OWNERS];
+unsigned ownerWeight[MAX_OWNERS];		// 0 stands for OWNER_DEFAULT_WEIGHT
+
+static Hole_t holes[MEMORY_SIZE];		// free list at the start of the round
+static unsigned holeCount;
+static unsigned rounds;					// admission rounds with waiting processes
+static unsigned admittedCount;			// processes started by a round
+static unsigned overdueCount;			// of those, started after the maximum delay
+static unsigned reservations;			// rounds stopped for an overdue process
+static unsigned long long waitTotal;	// sum of the waiting times of the admitted
+static unsigned waitMax;
+
+// fair-share: one queue per owner in arrival order, linked by pid (0 = none)
+static pid_t ownerHead[MAX_OWNERS];
+static pid_t ownerTail[MAX_OWNERS];
+static pid_t ownerNext[MAX_PROCESSES];
+static pid_t ownerPrev[MAX_PROCESSES];
+static unsigned ownerUsed[MAX_OWNERS];				// memory in use per owner
+static unsigned ownerAdmitted[MAX_OWNERS];
+static unsigned long long ownerWaitTotal[MAX_OWNERS];
+static unsigned ownerWaitMax[MAX_OWNERS];
+
+/* ---------------------------------------------------------------- */
+/*                Declarations of local helper functions            */
+static unsigned collectWaiting(PCB_t* waiting[]);
+static int compareArrival(const void* a, const void* b);
+static int compareSizeDecreasing(const void* a, const void* b);
+static void snapshotHoles(void);
+static Boolean packProcess(PCB_t* pProcess);
+static Boolean isOverdue(PCB_t* pProcess);
+static unsigned admitFairShare(void);
+static unsigned nextFairOwner(const Boolean skipped[]);
+static void admitted(PCB_t* pProcess, Boolean wasReady);
+static unsigned ownerOf(const PCB_t* pProcess);
+static unsigned weightOf(unsigned owner);
+static int compareOwnerArrival(pid_t a, pid_t b);
+
+/* ---------------------------------------------------------------- */
+/*                Externally available functions                    */
+/* ---------------------------------------------------------------- */
+
+Boolean parseAdmissionPolicy(const char* name)
+{
+	if (strcmp(name, "fifo") == 0) admissionPolicy = admissionFifo;
+	else if (strcmp(name, "lookahead") == 0) admissionPolicy = admissionLookahead;
+	else if (strcmp(name, "fair-share") == 0) admissionPolicy = admissionFairShare;
+	else return FALSE;
+	return TRUE;
+}
+
+Boolean parseOwnerSetting(const char* setting, unsigned values[], unsigned minimum, unsigned maximum)
+{
+	unsigned long owner, value;
+	const char* colon = strchr(setting, ':');
+	char* end;
+	unsigned o;
+
+	if (colon == NULL) return FALSE;
+	value = strtoul(colon + 1, &end, 10);
+	if ((colon[1] == '\0') || (*end != '\0') || (value < minimum) || (value > maximum)) return FALSE;
+	if (strncmp(setting, "all:", 4) == 0)
+	{
+		for (o = 0; o < MAX_OWNERS; o++) values[o] = (unsigned)value;
+		return TRUE;
+	}
+	owner = strtoul(setting, &end, 10);
+	if ((end != colon) || (end == setting)) return FALSE;
+	values[owner % MAX_OWNERS] = (unsigned)value;
+	return TRUE;
+}
+
+void resetOwnerSettings(void)
+{
+	memset(ownerQuota, 0, sizeof(ownerQuota));
+	memset(ownerWeight, 0, sizeof(ownerWeight));
+}
+
+void resetAdmission(void)
+{
+	rounds = 0;
+	admittedCount = 0;
+	overdueCount = 0;
+	reservations = 0;
+	waitTotal = 0;
+	waitMax = 0;
+	memset(ownerHead, 0, sizeof(ownerHead));
+	memset(ownerTail, 0, sizeof(ownerTail));
+	memset(ownerUsed, 0, sizeof(ownerUsed));
+	memset(ownerAdmitted, 0, sizeof(ownerAdmitted));
+	memset(ownerWaitTotal, 0, sizeof(ownerWaitTotal));
+	memset(ownerWaitMax, 0, sizeof(ownerWaitMax));
+}
+
+unsigned admitWaitingProcesses(void)
+{
+	static PCB_t* waiting[MAX_PROCESSES];
+	unsigned count, overdue, i;
+	unsigned started = 0;
+	Boolean compacted = FALSE;
+
+	if (admissionPolicy == admissionFairShare) return admitFairShare();
+	count = collectWaiting(waiting);
+	if (count == 0) return 0;
+	rounds++;
+	// the window: the oldest waiting processes, the overdue ones first
+	qsort(waiting, count, sizeof(waiting[0]), compareArrival);
+	if (count > admissionWindow) count = admissionWindow;
+	for (overdue = 0; (overdue < count) && isOverdue(waiting[overdue]); overdue++);
+	snapshotHoles();		// cached blocks are used by packProcess()
+
+	for (i = 0; i < overdue; i++)
+	{
+		if (!packProcess(waiting[i]) && !compacted && (usedMemory + waiting[i]->size <= MEMORY_SIZE))
+		{
+			logGeneric("Overdue process does not fit - attempting compaction");
+			compactMemoryWithSimulation();
+			compacted = TRUE;
+			snapshotHoles();
+			packProcess(waiting[i]);
+		}
+		if (waiting[i]->status != running)
+		{	// the younger processes must not take the memory it waits for
+			logPid(waiting[i]->pid, "Overdue process waits, admission stopped");
+			reservations++;
+			break;
+		}
+		overdueCount++;
+		started++;
+	}
+	if (i == overdue)
+	{	// best-fit decreasing for the others
+		qsort(waiting + overdue, count - overdue, sizeof(waiting[0]), compareSizeDecreasing);
+		for (; i < count; i++)
+			if (packProcess(waiting[i])) started++;
+	}
+	// everything considered in this round now counts as blocked
+	for (i = 0; i < count; i++)
+		if (waiting[i]->status == ready) waiting[i]->status = blocked;
+	return started;
+}
+
+void ownerProcessQueued(PCB_t* pProcess)
+{	// inserted from the tail, arrivals are almost always the youngest
+	unsigned owner = ownerOf(pProcess);
+	pid_t pid = pProcess->pid;
+	pid_t before = ownerTail[owner];
+
+	while ((before != 0) && (compareOwnerArrival(before, pid) > 0))
+		before = ownerPrev[before];
+	ownerPrev[pid] = before;
+	ownerNext[pid] = (before != 0) ? ownerNext[before] : ownerHead[owner];
+	if (ownerNext[pid] != 0) ownerPrev[ownerNext[pid]] = pid;
+	else ownerTail[owner] = pid;
+	if (before != 0) ownerNext[before] = pid;
+	else ownerHead[owner] = pid;
+}
+
+void ownerProcessUnqueued(PCB_t* pProcess)
+{
+	unsigned owner = ownerOf(pProcess);
+	pid_t pid = pProcess->pid;
+
+	if (ownerPrev[pid] != 0) ownerNext[ownerPrev[pid]] = ownerNext[pid];
+	else ownerHead[owner] = ownerNext[pid];
+	if (ownerNext[pid] != 0) ownerPrev[ownerNext[pid]] = ownerPrev[pid];
+	else ownerTail[owner] = ownerPrev[pid];
+}
+
+void ownerProcessPlaced(PCB_t* pProcess)
+{	// also the waiting time of the owner, the loading time is not part of it
+	unsigned owner = ownerOf(pProcess);
+	unsigned wait = systemTime - pProcess->arrival;
+
+	ownerUsed[owner] += pProcess->size;
+	ownerAdmitted[owner]++;
+	ownerWaitTotal[owner] += wait;
+	if (wait > ownerWaitMax[owner]) ownerWaitMax[owner] = wait;
+}
+
+void ownerProcessReleased(PCB_t* pProcess)
+{
+	ownerUsed[ownerOf(pProcess)] -= pProcess->size;
+}
+
+void logAdmissionStatistics(void)
+{
+	char buffer[200];
+	unsigned o;
+
+	for (o = 0; o < MAX_OWNERS; o++)
+	{
+		if (ownerAdmitted[o] == 0) continue;
+		sprintf(buffer, "Admission: owner %u (weight %u, quota %u): %u processes admitted, "
+			"waiting time mean %llu, max %u", o, weightOf(o), ownerQuota[o], ownerAdmitted[o],
+			ownerWaitTotal[o] / ownerAdmitted[o], ownerWaitMax[o]);
+		logGeneric(buffer);
+	}
+	if (admissionPolicy == admissionFifo) return;
+	sprintf(buffer, "Admission: %u rounds, %u processes admitted, %u of them overdue, "
+		"%u rounds stopped for an overdue process", rounds, admittedCount, overdueCount, reservations);
+	logGeneric(buffer);
+	sprintf(buffer, "Admission: waiting time mean %llu, max %u",
+		(admittedCount > 0) ? waitTotal / admittedCount : 0ULL, waitMax);
+	logGeneric(buffer);
+}
+
+void saveAdmissionCheckpoint(Checkpoint_t* pCheckpoint)
+{
+	pCheckpoint->admission.rounds = rounds;
+	pCheckpoint->admission.admittedCount = admittedCount;
+	pCheckpoint->admission.overdueCount = overdueCount;
+	pCheckpoint->admission.reservations = reservations;
+	pCheckpoint->admission.waitTotal = waitTotal;
+	pCheckpoint->admission.waitMax = waitMax;
+	memcpy(pCheckpoint->admission.ownerAdmitted, ownerAdmitted, sizeof(ownerAdmitted));
+	memcpy(pCheckpoint->admission.ownerWaitTotal, ownerWaitTotal, sizeof(ownerWaitTotal));
+	memcpy(pCheckpoint->admission.ownerWaitMax, ownerWaitMax, sizeof(ownerWaitMax));
+}
+
+void restoreAdmissionCheckpoint(const Checkpoint_t* pCheckpoint)
+{
+	BlockedProcess_t* current;
+	unsigned i;
+
+	rounds = pCheckpoint->admission.rounds;
+	admittedCount = pCheckpoint->admission.admittedCount;
+	overdueCount = pCheckpoint->admission.overdueCount;
+	reservations = pCheckpoint->admission.reservations;
+	waitTotal = pCheckpoint->admission.waitTotal;
+	waitMax = pCheckpoint->admission.waitMax;
+	memcpy(ownerAdmitted, pCheckpoint->admission.ownerAdmitted, sizeof(ownerAdmitted));
+	memcpy(ownerWaitTotal, pCheckpoint->admission.ownerWaitTotal, sizeof(ownerWaitTotal));
+	memcpy(ownerWaitMax, pCheckpoint->admission.ownerWaitMax, sizeof(ownerWaitMax));
+	memset(ownerHead, 0, sizeof(ownerHead));
+	memset(ownerTail, 0, sizeof(ownerTail));
+	memset(ownerUsed, 0, sizeof(ownerUsed));
+	for (current = blockedQueue; current != NULL; current = current->next)
+		ownerProcessQueued(current->process);
+	for (i = 0; i < MAX_PROCESSES; i++)
+		if (processTable[i].valid && (processTable[i].status == running))
+			ownerUsed[ownerOf(&processTable[i])] += processTable[i].size;
+}
+
+/* ----------------------------------------------------------------- */
+/*                       Local helper functions                      */
+/* ----------------------------------------------------------------- */
+
+static unsigned collectWaiting(PCB_t* waiting[])
+{
+	BlockedProcess_t* current;
+	unsigned count = 0;
+
+	for (current = blockedQueue; current != NULL; current = current->next)
+		waiting[count++] = current->process;
+	return count;
+}
+
+static int compareArrival(const void* a, const void* b)
+{	// earlier arrival first, then lower pid
+	const PCB_t* pA = *(PCB_t* const*)a;
+	const PCB_t* pB = *(PCB_t* const*)b;
+
+	if (pA->arrival != pB->arrival) return (pA->arrival < pB->arrival) ? -1 : 1;
+	return (pA->pid < pB->pid) ? -1 : (pA->pid > pB->pid);
+}
+
+static int compareSizeDecreasing(const void* a, const void* b)
+{	// larger first, then by arrival
+	const PCB_t* pA = *(PCB_t* const*)a;
+	const PCB_t* pB = *(PCB_t* const*)b;
+
+	if (pA->size != pB->size) return (pA->size > pB->size) ? -1 : 1;
+	return compareArrival(a, b);
+}
+
+static void snapshotHoles(void)
+{
+	FreeBlock_t* current;
+
+	holeCount = 0;
+	for (current = freeList; current != NULL; current = current->next)
+	{
+		holes[holeCount].start = current->start;
+		holes[holeCount].size = current->size;
+		holes[holeCount].node = nodeOf(current->start);
+		holeCount++;
+	}
+}
+
+static Boolean packProcess(PCB_t* pProcess)
+{	// a cached block of its size or the best fitting hole, on the first node
+	// of the placement order that has one
+	unsigned order[MAX_NODES];
+	unsigned nodes = placementOrder(homeNode(pProcess), order);
+	unsigned n, h, best, start;
+	Boolean wasReady;
+
+	for (n = 0; n < nodes; n++)
+	{
+		if (quickFitAllocate(pProcess->size, order[n], &start)) break;	// fits exactly
+		best = holeCount;
+		for (h = 0; h < holeCount; h++)
+			if ((holes[h].node == order[n]) && (holes[h].size >= pProcess->size)
+				&& ((best == holeCount) || (holes[h].size < holes[best].size)))
+				best = h;
+		if (best == holeCount) continue;
+		// small processes go to the top of the hole with two-ended placement
+		if ((placementPolicy == placementTwoEnded) && (pProcess->size < smallThreshold))
+			start = holes[best].start + holes[best].size - pProcess->size;
+		else
+		{
+			start = holes[best].start;
+			holes[best].start += pProcess->size;
+		}
+		holes[best].size -= pProcess->size;
+		if (!claimFreeRange(start, pProcess->size)) return FALSE;	// not reached
+		break;
+	}
+	if (n == nodes)
+	{	// the missing hole may sit in the quick-fit caches, merged only now
+		if (quickFitFlush() == 0) return FALSE;
+		logGeneric("Quick-fit caches flushed to serve the request");
+		snapshotHoles();
+		return packProcess(pProcess);
+	}
+	removeBlockedProcess(pProcess);
+	wasReady = (pProcess->status == ready);
+	placeProcess(pProcess, start);
+	admitted(pProcess, wasReady);
+	logPidMem(pProcess->pid, "Process admitted by lookahead packing");
+	return TRUE;
+}
+
+static Boolean isOverdue(PCB_t* pProcess)
+{
+	return systemTime - pProcess->arrival >= maxAdmissionDelay;
+}
+
+static unsigned admitFairShare(void)
+{	// the oldest process of the owner with the lowest share, until none fits
+	Boolean skipped[MAX_OWNERS] = { FALSE };
+	Boolean compacted = FALSE, flushed = FALSE, missed = FALSE, fits, found, wasReady;
+	BlockedProcess_t* current;
+	PCB_t* pProcess;
+	unsigned owner, start;
+	unsigned started = 0;
+
+	if (blockedQueue == NULL) return 0;
+	rounds++;
+	for (;;)
+	{
+		if ((owner = nextFairOwner(skipped)) == MAX_OWNERS)
+		{	// the skipped processes may fit once the quick-fit caches are merged
+			if (!missed || flushed || (quickFitFlush() == 0)) break;
+			logGeneric("Quick-fit caches flushed to serve the request");
+			flushed = TRUE;
+			memset(skipped, 0, sizeof(skipped));
+			continue;
+		}
+		pProcess = &processTable[ownerHead[owner]];
+		fits = (usedMemory + pProcess->size <= MEMORY_SIZE);
+		// the caches stay for the other owners, unless the process is overdue
+		found = fits && tryAllocateMemory(pProcess->size, homeNode(pProcess), &start);
+		if (!found && isOverdue(pProcess))
+		{
+			found = fits && allocateMemory(pProcess->size, homeNode(pProcess), &start);
+			if (!found && !compacted && fits)
+			{
+				logGeneric("Overdue process does not fit - attempting compaction");
+				compactMemoryWithSimulation();
+				compacted = TRUE;
+				found = allocateMemory(pProcess->size, homeNode(pProcess), &start);
+			}
+			if (!found)
+			{	// the other owners must not take the memory it waits for
+				logPid(pProcess->pid, "Overdue process waits, admission stopped");
+				reservations++;
+				break;
+			}
+		}
+		if (!found)
+		{	// the next owner may have a process that fits
+			skipped[owner] = TRUE;
+			missed = missed || fits;	// not only short of memory in total
+			continue;
+		}
+		if (isOverdue(pProcess)) overdueCount++;
+		removeBlockedProcess(pProcess);
+		wasReady = (pProcess->status == ready);
+		placeProcess(pProcess, start);
+		admitted(pProcess, wasReady);
+		logPidMem(pProcess->pid, "Process admitted by fair share");
+		started++;
+	}
+	// everything waiting now counts as blocked
+	for (current = blockedQueue; current != NULL; current = current->next)
+		if (current->process->status == ready) current->process->status = blocked;
+	return started;
+}
+
+static unsigned nextFairOwner(const Boolean skipped[])
+{	// returns MAX_OWNERS if no owner may start its oldest process
+	unsigned long long share, bestShare;
+	unsigned owner, best = MAX_OWNERS;
+	const PCB_t* pHead;
+
+	for (owner = 0; owner < MAX_OWNERS; owner++)
+	{
+		if ((ownerHead[owner] == 0) || skipped[owner]) continue;
+		pHead = &processTable[ownerHead[owner]];
+		if ((ownerQuota[owner] > 0) && (ownerUsed[owner] > 0)
+			&& (ownerUsed[owner] + pHead->size > ownerQuota[owner]))
+			continue;		// over its quota
+		if (best == MAX_OWNERS)
+		{
+			best = owner;
+			continue;
+		}
+		// used / weight compared without division, ties go to the older process
+		share = (unsigned long long)ownerUsed[owner] * weightOf(best);
+		bestShare = (unsigned long long)ownerUsed[best] * weightOf(owner);
+		if ((share < bestShare)
+			|| ((share == bestShare) && (compareOwnerArrival(ownerHead[owner], ownerHead[best]) < 0)))
+			best = owner;
+	}
+	return best;
+}
+
+static void admitted(PCB_t* pProcess, Boolean wasReady)
+{	// waiting time statistics and loading time of a process just placed
+	unsigned wait = systemTime - pProcess->arrival;
+
+	if (wasReady) systemTime += LOADING_DURATION;	// admitted in the round of its arrival
+	admittedCount++;
+	waitTotal += wait;
+	if (wait > waitMax) waitMax = wait;
+}
+
+static unsigned ownerOf(const PCB_t* pProcess)
+{
+	return pProcess->ownerID % MAX_OWNERS;
+}
+
+static unsigned weightOf(unsigned owner)
+{
+	return (ownerWeight[owner] > 0) ? ownerWeight[owner] : OWNER_DEFAULT_WEIGHT;
+}
+
+static int compareOwnerArrival(pid_t a, pid_t b)
+{	// earlier arrival first, then lower pid
+	if (processTable[a].arrival != processTable[b].arrival)
+		return (processTable[a].arrival < processTable[b].arrival) ? -1 : 1;
+	return (a < b) ? -1 : (a > b);
+}
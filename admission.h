@@ -0,0 +1,92 @@
+/* Include-file defining the admission of waiting processes into memory		*/
+/* By default a process is admitted on arrival if a block fits, otherwise	*/
+/* it waits in the blocked queue, which is served in ascending size order.	*/
+/* Lookahead admission lets the arrivals of one instant wait as well and	*/
+/* then packs a window of the oldest waiting processes at once into the		*/
+/* current holes of the free list: processes waiting longer than the		*/
+/* maximum delay first in arrival order, then the others by best-fit		*/
+/* decreasing. An overdue process that does not fit even after a			*/
+/* compaction keeps all younger ones from being admitted, which bounds its	*/
+/* delay.																	*/
+/* Fair-share admission keeps one queue per owner in arrival order. A round	*/
+/* repeatedly starts the oldest process of the owner with the lowest share,	*/
+/* its memory in use divided by its weight, among the owners whose next		*/
+/* process stays within their quota. An owner without memory in use may		*/
+/* always start one process. An overdue process that does not fit even		*/
+/* after a compaction ends the round, like in lookahead admission.			*/
+/* Owner IDs are mapped to MAX_OWNERS accounts modulo MAX_OWNERS.			*/
+#ifndef __ADMISSION__
+#define __ADMISSION__
+
+#include "bs_types.h"
+
+/* data type for the admission policies */
+typedef enum
+	{
+		admissionFifo,		// on arrival, then the blocked queue by size
+		admissionLookahead,	// a window of waiting processes packed at once
+		admissionFairShare	// per-owner queues, lowest weighted share first
+	} AdmissionPolicy_t;
+
+#define ADMISSION_DEFAULT_WINDOW	16		// waiting processes packed in one round
+#define ADMISSION_DEFAULT_MAX_DELAY	2000	// waiting time after which a process goes first
+#define ADMISSION_MAX_WINDOW		MAX_PROCESSES
+#define MAX_OWNERS					64		// owner accounts of fair-share admission
+#define OWNER_DEFAULT_WEIGHT		1
+#define OWNER_MAX_WEIGHT			1000
+
+extern AdmissionPolicy_t admissionPolicy;	// admissionFifo by default
+extern unsigned admissionWindow;		// processes considered per round
+extern unsigned maxAdmissionDelay;		// time units
+extern unsigned ownerQuota[MAX_OWNERS];		// memory units per owner, 0 = none
+extern unsigned ownerWeight[MAX_OWNERS];	// 0 = OWNER_DEFAULT_WEIGHT
+
+
+Boolean parseAdmissionPolicy(const char* name);
+/* sets admissionPolicy from its name "fifo", "lookahead" or "fair-share"	*/
+/* returns FALSE for an unknown name										*/
+
+Boolean parseOwnerSetting(const char* setting, unsigned values[],
+						   unsigned minimum, unsigned maximum);
+/* sets values[owner] from "owner:value" or every entry from "all:value"	*/
+/* returns FALSE for a malformed setting or a value out of range			*/
+
+void resetOwnerSettings(void);
+/* sets all quotas to none and all weights to the default					*/
+
+void resetAdmission(void);
+/* clears the admission statistics and the owner accounts, called at		*/
+/* start of a run															*/
+
+unsigned admitWaitingProcesses(void);
+/* one round of the lookahead or fair-share admission. Lookahead packs the	*/
+/* window of the oldest waiting processes into the holes of the free list	*/
+/* and starts the packed ones, fair-share starts processes owner by owner.	*/
+/* Processes that arrived since the last round (status ready) are charged	*/
+/* the loading time on admission, like an admission on arrival.				*/
+/* returns the number of processes started									*/
+
+void ownerProcessQueued(PCB_t* pProcess);
+void ownerProcessUnqueued(PCB_t* pProcess);
+/* a process was added to or removed from the blocked queue					*/
+
+void ownerProcessPlaced(PCB_t* pProcess);
+void ownerProcessReleased(PCB_t* pProcess);
+/* a process got memory or freed it, updates memory and waiting time of	*/
+/* its owner																*/
+
+struct Checkpoint;
+
+void saveAdmissionCheckpoint(struct Checkpoint* pCheckpoint);
+/* stores the admission statistics, the owner queues and memory are		*/
+/* rebuilt from the blocked queue and the process table						*/
+
+void restoreAdmissionCheckpoint(const struct Checkpoint* pCheckpoint);
+/* restores the admission statistics, called after the blocked queue and	*/
+/* the process table are restored											*/
+
+void logAdmissionStatistics(void);
+/* prints admitted processes and waiting times per owner and, except for	*/
+/* fifo admission, rounds and waiting times of the rounds					*/
+
+#endif /* __ADMISSION__ */
@@ -0,0 +1,258 @@
+/* Implementation of the backing arena of the simulated memory */
+/* for comments on the functions see the associated .h-file */
+
+/* ---------------------------------------------------------------- */
+/* Include required external definitions */
+#include "globals.h"
+#include "arena.h"
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define ARENA_STREAMING
+#include <emmintrin.h>
+#endif
+
+#define PATTERN_STEP 0x9E3779B97F4A7C15ULL	// odd, so successive words differ
+
+/* ----------------------------------------------------------------	*/
+/* Declarations of global variables visible only in this file 		*/
+Boolean arenaEnabled = FALSE;
+unsigned arenaScale = ARENA_DEFAULT_SCALE;
+
+static unsigned char* arena = NULL;		// MEMORY_SIZE * arenaScale bytes
+static unsigned char* staging = NULL;	// same size, holds sources of cyclic moves
+static size_t arenaBytes = 0;			// size of both buffers
+static unsigned long long bytesFilled;	// pattern bytes written at placements
+static unsigned long long bytesMoved;	// bytes relocated by compactions
+static unsigned long long bytesStreamed;	// part of bytesMoved copied non-temporally
+static unsigned long long bytesStaged;	// bytes copied twice to break a cycle
+static unsigned long long moveCount;	// relocated processes
+static unsigned long long verifications;	// processes checked against their pattern
+static unsigned verifyFailures;			// damaged processes found
+static double copyNs;					// time spent in the relocations
+
+/* ---------------------------------------------------------------- */
+/*                Declarations of local helper functions            */
+static unsigned long long patternSeed(pid_t pid);
+static void fillPattern(unsigned char* pBytes, size_t length, pid_t pid);
+static Boolean checkPattern(const unsigned char* pBytes, size_t length, pid_t pid);
+static void verifyProcess(pid_t pid, unsigned start, unsigned size);
+static Boolean isSourceBlocked(const ArenaMove_t* pMove, const ArenaMove_t moves[],
+	const Boolean pending[], const Boolean staged[], unsigned count);
+
+/* ---------------------------------------------------------------- */
+/*                Externally available functions                    */
+/* ---------------------------------------------------------------- */
+
+Boolean resetArena(void)
+{
+	size_t bytes;
+	unsigned i;
+
+	bytesFilled = 0;
+	bytesMoved = 0;
+	bytesStreamed = 0;
+	bytesStaged = 0;
+	moveCount = 0;
+	verifications = 0;
+	verifyFailures = 0;
+	copyNs = 0.0;
+	if (!arenaEnabled) return TRUE;
+	if (arenaScale == 0) arenaScale = 1;
+	bytes = (size_t)MEMORY_SIZE * arenaScale;
+	if (bytes != arenaBytes)
+	{
+		free(arena);
+		free(staging);
+		arena = (unsigned char*)malloc(bytes);
+		staging = (unsigned char*)malloc(bytes);
+		arenaBytes = bytes;
+		if ((arena == NULL) || (staging == NULL))
+		{
+			fprintf(stderr, "Cannot allocate an arena of %zu bytes, arena mode disabled\n", bytes);
+			free(arena);
+			free(staging);
+			arena = NULL;
+			staging = NULL;
+			arenaBytes = 0;
+			arenaEnabled = FALSE;
+			return FALSE;
+		}
+	}
+	for (i = 0; i < MAX_PROCESSES; i++)
+		if (processTable[i].valid && (processTable[i].status == running))
+			arenaProcessPlaced(&processTable[i]);
+	return TRUE;
+}
+
+void arenaProcessPlaced(PCB_t* pProcess)
+{
+	size_t length = (size_t)pProcess->size * arenaScale;
+
+	if (!arenaEnabled) return;
+	fillPattern(arena + (size_t)pProcess->start * arenaScale, length, pProcess->pid);
+	bytesFilled += length;
+}
+
+void arenaProcessReleased(PCB_t* pProcess)
+{
+	if (!arenaEnabled) return;
+	verifyProcess(pProcess->pid, pProcess->start, pProcess->size);
+}
+
+void arenaCompact(const ArenaMove_t moves[], unsigned count)
+{
+	static Boolean pending[MAX_PROCESSES];
+	static Boolean staged[MAX_PROCESSES];
+	unsigned remaining = count;
+	unsigned i, k;
+	Boolean progress, ascending = TRUE;
+	size_t from, to, length;
+	double t;
+
+	if (!arenaEnabled || (count == 0)) return;
+	for (i = 0; i < count; i++)
+	{
+		pending[i] = TRUE;
+		staged[i] = FALSE;
+	}
+	t = nowNs();
+	while (remaining > 0)
+	{	// a move is carried out once no other pending process still sits in
+		// its target range. The compaction slides the processes of a node
+		// downwards, then one pass in each direction moves everything
+		progress = FALSE;
+		for (k = 0; k < count; k++)
+		{
+			i = ascending ? k : count - 1 - k;
+			if (!pending[i] || isSourceBlocked(&moves[i], moves, pending, staged, count)) continue;
+			from = (size_t)moves[i].from * arenaScale;
+			to = (size_t)moves[i].to * arenaScale;
+			length = (size_t)moves[i].size * arenaScale;
+			arenaCopy(arena + to, (staged[i] ? staging : arena) + from, length);
+#ifdef ARENA_STREAMING
+			if ((length >= ARENA_STREAM_THRESHOLD) && (staged[i] || (to + length <= from) || (from + length <= to)))
+				bytesStreamed += length;
+#endif
+			bytesMoved += length;
+			pending[i] = FALSE;
+			remaining--;
+			progress = TRUE;
+		}
+		ascending = !ascending;
+		if (!progress)
+		{	// the targets form a cycle: park the first pending source aside
+			for (i = 0; !pending[i] || staged[i]; i++);
+			from = (size_t)moves[i].from * arenaScale;
+			length = (size_t)moves[i].size * arenaScale;
+			memcpy(staging + from, arena + from, length);
+			staged[i] = TRUE;
+			bytesStaged += length;
+		}
+	}
+	copyNs += nowNs() - t;
+	moveCount += count;
+	for (i = 0; i < count; i++)
+		verifyProcess(moves[i].pid, moves[i].to, moves[i].size);
+}
+
+void arenaCopy(void* destination, const void* source, size_t length)
+{
+#ifdef ARENA_STREAMING
+	unsigned char* pDestination = (unsigned char*)destination;
+	const unsigned char* pSource = (const unsigned char*)source;
+	size_t head;
+
+	if ((length >= ARENA_STREAM_THRESHOLD)
+		&& ((pDestination + length <= pSource) || (pSource + length <= pDestination)))
+	{	// the target is not read again soon, so it should not evict the cache
+		head = (16 - ((size_t)pDestination & 15)) & 15;
+		memcpy(pDestination, pSource, head);
+		pDestination += head;
+		pSource += head;
+		length -= head;
+		for (; length >= 64; length -= 64, pDestination += 64, pSource += 64)
+		{
+			__m128i a = _mm_loadu_si128((const __m128i*)pSource);
+			__m128i b = _mm_loadu_si128((const __m128i*)(pSource + 16));
+			__m128i c = _mm_loadu_si128((const __m128i*)(pSource + 32));
+			__m128i d = _mm_loadu_si128((const __m128i*)(pSource + 48));
+			_mm_stream_si128((__m128i*)pDestination, a);
+			_mm_stream_si128((__m128i*)(pDestination + 16), b);
+			_mm_stream_si128((__m128i*)(pDestination + 32), c);
+			_mm_stream_si128((__m128i*)(pDestination + 48), d);
+		}
+		_mm_sfence();	// the streamed stores are visible before the tail
+		memcpy(pDestination, pSource, length);
+		return;
+	}
+#endif
+	memmove(destination, source, length);
+}
+
+void logArenaStatistics(void)
+{
+	char buffer[200];
+
+	if (!arenaEnabled) return;
+	sprintf(buffer, "Arena: %zu bytes (%u per unit), %llu bytes filled, %llu processes "
+		"moved", arenaBytes, arenaScale, bytesFilled, moveCount);
+	logGeneric(buffer);
+	sprintf(buffer, "Arena: %llu bytes moved (%llu streamed, %llu staged) in %.3f ms, %.2f GB/s",
+		bytesMoved, bytesStreamed, bytesStaged, copyNs / 1e6,
+		(copyNs > 0.0) ? (double)bytesMoved / copyNs : 0.0);
+	logGeneric(buffer);
+	sprintf(buffer, "Arena: %llu processes verified, %u damaged", verifications, verifyFailures);
+	logGeneric(buffer);
+}
+
+/* ----------------------------------------------------------------- */
+/*                       Local helper functions                      */
+/* ----------------------------------------------------------------- */
+
+static unsigned long long patternSeed(pid_t pid)
+{	// different for every pid, never zero
+	return ((unsigned long long)pid + 1) * 0xD6E8FEB86659FD93ULL;
+}
+
+static void fillPattern(unsigned char* pBytes, size_t length, pid_t pid)
+{	// word i of the range holds seed + i * PATTERN_STEP, independent of the address
+	unsigned long long word = patternSeed(pid);
+
+	for (; length >= sizeof(word); length -= sizeof(word), pBytes += sizeof(word))
+	{
+		memcpy(pBytes, &word, sizeof(word));
+		word += PATTERN_STEP;
+	}
+	memcpy(pBytes, &word, length);
+}
+
+static Boolean checkPattern(const unsigned char* pBytes, size_t length, pid_t pid)
+{
+	unsigned long long word = patternSeed(pid);
+
+	for (; length >= sizeof(word); length -= sizeof(word), pBytes += sizeof(word))
+	{
+		if (memcmp(pBytes, &word, sizeof(word)) != 0) return FALSE;
+		word += PATTERN_STEP;
+	}
+	return memcmp(pBytes, &word, length) == 0;
+}
+
+static void verifyProcess(pid_t pid, unsigned start, unsigned size)
+{
+	verifications++;
+	if (checkPattern(arena + (size_t)start * arenaScale, (size_t)size * arenaScale, pid)) return;
+	verifyFailures++;
+	fprintf(stderr, "Arena: memory of process %u at %u damaged\n", (unsigned)pid, start);
+}
+
+static Boolean isSourceBlocked(const ArenaMove_t* pMove, const ArenaMove_t moves[],
+	const Boolean pending[], const Boolean staged[], unsigned count)
+{	// TRUE if the target range still holds a process that has not moved yet
+	unsigned i;
+
+	for (i = 0; i < count; i++)
+		if (pending[i] && !staged[i] && (&moves[i] != pMove)
+			&& (moves[i].from < pMove->to + pMove->size) && (pMove->to < moves[i].from + moves[i].size))
+			return TRUE;
+	return FALSE;
+}
@@ -0,0 +1,57 @@
+/* Include-file defining the backing arena of the simulated memory			*/
+/* In arena mode the simulated memory is a real host buffer of MEMORY_SIZE	*/
+/* units of arenaScale bytes each. A process gets its memory filled with a	*/
+/* pattern derived from its pid when it is placed, compaction really moves	*/
+/* the bytes of the relocated processes and every process is verified		*/
+/* after a move and when it releases its memory. The simulation itself is	*/
+/* not changed by the arena, it only measures the cost of the relocations.	*/
+#ifndef __ARENA__
+#define __ARENA__
+
+#include <stddef.h>
+#include "bs_types.h"
+
+// default number of bytes of one memory unit
+#define ARENA_DEFAULT_SCALE 1
+// copies of at least this many bytes bypass the cache (non-temporal stores)
+#define ARENA_STREAM_THRESHOLD (256 * 1024)
+
+/* data type of one relocation of a process by the compaction */
+typedef struct
+	{
+		pid_t pid;
+		unsigned from;			// old start address, in memory units
+		unsigned to;			// new start address, in memory units
+		unsigned size;			// in memory units
+	} ArenaMove_t;
+
+extern Boolean arenaEnabled;		// back the memory by a real buffer, FALSE by default
+extern unsigned arenaScale;			// bytes per memory unit
+
+
+Boolean resetArena(void);
+/* (re)allocates the arena if enabled and fills the memory of all running	*/
+/* processes, called at start of a run and after a restore					*/
+/* returns FALSE if the buffer cannot be allocated, the arena is disabled	*/
+
+void arenaProcessPlaced(PCB_t* pProcess);
+/* fills the memory of a process that just got its memory with its pattern	*/
+
+void arenaProcessReleased(PCB_t* pProcess);
+/* verifies the pattern of a process that is about to return its memory		*/
+
+void arenaCompact(const ArenaMove_t moves[], unsigned count);
+/* performs the relocations of one compaction run. The moves may overlap	*/
+/* each other's old ranges in any order, they are carried out in an order	*/
+/* that never overwrites data not moved yet. Every moved process is			*/
+/* verified afterwards														*/
+
+void arenaCopy(void* destination, const void* source, size_t length);
+/* copies length bytes, the ranges may overlap. Large non-overlapping		*/
+/* copies use non-temporal stores where available							*/
+
+void logArenaStatistics(void);
+/* prints bytes filled and moved, the copy time and the verification		*/
+/* results, only in arena mode												*/
+
+#endif /* __ARENA__ */
@@ -0,0 +1,402 @@
+/* Micro and macro benchmarks for the hot paths of the memory manager	*/
+/* - findFreeBlock()/freeMemory() under synthetic fragmentation patterns	*/
+/* - runToNextEvent()/updateAllVirtualTimes() vs. number of running		*/
+/*   processes																*/
+/* - event queue (timing wheel) vs. number of pending events				*/
+/* - compactMemoryWithSimulation() vs. number of resident processes		*/
+/*   with and without real byte moves in the arena						*/
+/* - end-to-end events per second on generated traces					*/
+/* Results are reported as ns/op, ops/s and heap allocations per op. The	*/
+/* allocation counter is only available when linked with --wrap=malloc.	*/
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <limits.h>
+#include "bs_types.h"
+#include "globals.h"
+#include "core.h"
+#include "loader.h"
+#include "executer.h"
+#include "eventqueue.h"
+#include "summary.h"
+#include "stats.h"
+#include "arena.h"
+
+// free list of the allocator benchmarks, larger than the simulated memory
+// so that even 4096 holes leave a large block at the end
+#define BENCH_LIST_SIZE		(1024U * MEMORY_SIZE)
+
+/* ----------------------------------------------------------------	*/
+/* Define the global variables of globals.h for the benchmark host	*/
+PCB_t processTable[MAX_PROCESSES]; 	// the process table
+unsigned systemTime = 0; 			// the current system time (up time)
+unsigned usedMemory = 0;			// amount of used physical memory
+unsigned runningCount = 0;			// counter of currently running processes
+Boolean batchComplete = FALSE;		// end of pending processes in the file indicator
+FILE* processFile;					// file containing the processes to simulate
+PCB_t candidateProcess;				// only for simulation purposes
+unsigned simSeed = 1;				// seed of the random number generator of this run
+
+/* ----------------------------------------------------------------	*/
+/* Declarations of global variables visible only in this file 		*/
+static unsigned long long allocationCount = 0;	// heap allocations so far
+static unsigned benchIterations = 200000;		// --iterations
+static unsigned maxTraceProcesses = 100000;		// --max-processes
+static unsigned rngState = 2463534242U;			// state of the benchmark RNG
+
+#ifdef BENCH_COUNT_MALLOC
+void* __real_malloc(size_t size);
+void* __wrap_malloc(size_t size)
+{	// every malloc of the simulator is routed through here by the linker
+	allocationCount++;
+	return __real_malloc(size);
+}
+#endif
+
+/* ---------------------------------------------------------------- */
+/*                Declarations of local functions                   */
+static unsigned nextRandom(void);
+static void report(const char* name, const char* param, unsigned long long ops,
+	double elapsedNs, unsigned long long allocations);
+static void resetFreeList(unsigned start, unsigned size);
+static void fragmentFreeList(unsigned holes, unsigned holeSize);
+static unsigned allocate(unsigned size);
+static void allocFreeLoop(unsigned size, unsigned iterations);
+static void benchAllocator(void);
+static void benchEventScan(void);
+static void benchEventQueue(void);
+static void benchCompaction(void);
+static void benchEndToEnd(void);
+
+
+int main(int argc, char* argv[])
+{
+	int i;
+
+	for (i = 1; i < argc; i++)
+	{
+		if ((strcmp(argv[i], "--iterations") == 0) && (i + 1 < argc))
+			benchIterations = (unsigned)strtoul(argv[++i], NULL, 10);
+		else if ((strcmp(argv[i], "--max-processes") == 0) && (i + 1 < argc))
+			maxTraceProcesses = (unsigned)strtoul(argv[++i], NULL, 10);
+		else
+		{
+			printf("Usage: %s [--iterations N] [--max-processes N]\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	logLevel = LOG_LEVEL_OFF;		// measure the simulator, not the console
+
+	printf("%-28s %-14s %12s %14s %10s\n", "benchmark", "parameter", "ns/op", "ops/s", "allocs/op");
+	benchAllocator();
+	benchEventScan();
+	benchEventQueue();
+	benchCompaction();
+	benchEndToEnd();
+	return EXIT_SUCCESS;
+}
+
+/* ---------------------------------------------------------------- */
+/*                Implementation of local functions                 */
+
+static unsigned nextRandom(void)
+{	// xorshift32, identical sequence on every platform
+	rngState ^= rngState << 13;
+	rngState ^= rngState >> 17;
+	rngState ^= rngState << 5;
+	return rngState;
+}
+
+static void report(const char* name, const char* param, unsigned long long ops,
+	double elapsedNs, unsigned long long allocations)
+{
+	double nsPerOp = (ops > 0) ? elapsedNs / (double)ops : 0.0;
+
+	printf("%-28s %-14s %12.1f %14.0f", name, param, nsPerOp,
+		(elapsedNs > 0.0) ? (double)ops * 1e9 / elapsedNs : 0.0);
+#ifdef BENCH_COUNT_MALLOC
+	printf(" %10.3f\n", (ops > 0) ? (double)allocations / (double)ops : 0.0);
+#else
+	printf(" %10s\n", "n/a");
+#endif
+	fflush(stdout);
+}
+
+static void resetFreeList(unsigned start, unsigned size)
+{	// replace the free list by one block
+	while (freeList != NULL)
+	{
+		FreeBlock_t* temp = freeList;
+		freeList = freeList->next;
+		free(temp);
+	}
+	resetStats();
+	freeMemory(start, size);
+}
+
+static void fragmentFreeList(unsigned holes, unsigned holeSize)
+{	// free list of <holes> holes of holeSize separated by allocated ranges
+	// of the same size, followed by one large block
+	unsigned i;
+
+	resetFreeList(0, 2 * holes * holeSize + BENCH_LIST_SIZE);
+	for (i = 0; i < holes; i++)
+		freeMemory(allocate(2 * holeSize), holeSize);		// keep the upper half allocated
+}
+
+static unsigned allocate(unsigned size)
+{	// findFreeBlock() that must succeed, a failed allocation would be
+	// measured as a success and the matching free would release garbage
+	unsigned start;
+
+	if (!findFreeBlock(size, &start))
+	{
+		fprintf(stderr, "Benchmark setup error: no free block of size %u\n", size);
+		exit(EXIT_FAILURE);
+	}
+	return start;
+}
+
+static void allocFreeLoop(unsigned size, unsigned iterations)
+{
+	unsigned i;
+
+	for (i = 0; i < iterations; i++)
+		freeMemory(allocate(size), size);
+}
+
+static void benchAllocator(void)
+{	// findFreeBlock()/freeMemory() pairs under different fragmentation patterns
+	static const unsigned holeCounts[] = { 0, 16, 256, 4096 };
+	char param[32];
+	unsigned h, i;
+	unsigned long long allocations;
+	double t;
+
+	for (h = 0; h < sizeof(holeCounts) / sizeof(holeCounts[0]); h++)
+	{
+		sprintf(param, "holes=%u", holeCounts[h]);
+
+		// request fits into the first hole: best case of first-fit
+		fragmentFreeList(holeCounts[h], 8);
+		allocFreeLoop(8, benchIterations / 10 + 1);	// warm-up, not measured
+		allocations = allocationCount;
+		t = nowNs();
+		allocFreeLoop(8, benchIterations);
+		report("alloc_free/first_hole", param, benchIterations, nowNs() - t, allocationCount - allocations);
+
+		// request fits no hole: the whole list is searched and the free walks to the end
+		allocFreeLoop(9, benchIterations / 10 + 1);
+		allocations = allocationCount;
+		t = nowNs();
+		allocFreeLoop(9, benchIterations);
+		report("alloc_free/no_hole_fits", param, benchIterations, nowNs() - t, allocationCount - allocations);
+	}
+
+	// random sizes, random release order: steady state churn
+	{
+		enum { LIVE = 512 };
+		unsigned liveStart[LIVE], liveSize[LIVE];
+		unsigned slot;
+
+		resetFreeList(0, BENCH_LIST_SIZE);
+		for (slot = 0; slot < LIVE; slot++)
+		{
+			liveSize[slot] = 1 + nextRandom() % MEMORY_SIZE;
+			liveStart[slot] = allocate(liveSize[slot]);
+		}
+		for (i = 0; i < benchIterations / 10 + 1; i++)
+		{	// warm-up, not measured
+			slot = nextRandom() % LIVE;
+			freeMemory(liveStart[slot], liveSize[slot]);
+			liveSize[slot] = 1 + nextRandom() % MEMORY_SIZE;
+			liveStart[slot] = allocate(liveSize[slot]);
+		}
+		allocations = allocationCount;
+		t = nowNs();
+		for (i = 0; i < benchIterations; i++)
+		{
+			slot = nextRandom() % LIVE;
+			freeMemory(liveStart[slot], liveSize[slot]);
+			liveSize[slot] = 1 + nextRandom() % MEMORY_SIZE;
+			liveStart[slot] = allocate(liveSize[slot]);
+		}
+		report("alloc_free/random_churn", "live=512", benchIterations, nowNs() - t, allocationCount - allocations);
+	}
+	resetFreeList(0, MEMORY_SIZE);
+}
+
+static void benchEventScan(void)
+{	// cost of determining the next event with k running processes
+	static const unsigned counts[] = { 1, 10, 100, MAX_PROCESSES - 1 };
+	char param[32];
+	unsigned c, i, pid;
+	unsigned long long allocations;
+	SchedulingEvent_t event;
+	pid_t eventPid;
+	double t;
+
+	for (c = 0; c < sizeof(counts) / sizeof(counts[0]); c++)
+	{
+		for (pid = 0; pid < MAX_PROCESSES; pid++) processTable[pid].valid = FALSE;
+		initCores();
+		for (pid = 1; pid <= counts[c]; pid++)
+		{
+			processTable[pid].valid = TRUE;
+			processTable[pid].status = running;
+			processTable[pid].pid = pid;
+			processTable[pid].duration = 0xFFFFFFF0U - pid;	// never completes during the benchmark
+			processTable[pid].usedCPU = 0;
+			assignProcessToCore(pid);
+		}
+		runningCount = counts[c];
+		candidateProcess.valid = FALSE;
+		sprintf(param, "running=%u", counts[c]);
+
+		allocations = allocationCount;
+		t = nowNs();
+		for (i = 0; i < benchIterations; i++)
+			runToNextEvent(&event, &eventPid);
+		report("runToNextEvent", param, benchIterations, nowNs() - t, allocationCount - allocations);
+
+		allocations = allocationCount;
+		t = nowNs();
+		for (i = 0; i < benchIterations; i++)
+			updateAllVirtualTimes(counts[c]);
+		report("updateAllVirtualTimes", param, benchIterations, nowNs() - t, allocationCount - allocations);
+	}
+	for (pid = 0; pid < MAX_PROCESSES; pid++) processTable[pid].valid = FALSE;
+	runningCount = 0;
+}
+
+static void benchEventQueue(void)
+{	// hold model: the next event is taken and rescheduled into the future,
+	// so the number of pending events stays constant
+	static const unsigned counts[] = { 10, 1000, 100000, 1000000 };
+	char param[32];
+	unsigned c, i;
+	unsigned long long allocations;
+	Event_t* events;
+	Event_t* pEvent;
+	double t;
+
+	for (c = 0; c < sizeof(counts) / sizeof(counts[0]); c++)
+	{
+		events = (Event_t*)malloc(counts[c] * sizeof(Event_t));
+		if (events == NULL) return;
+		initEventQueue(0);
+		for (i = 0; i < counts[c]; i++)
+		{
+			initEvent(&events[i], completed, (pid_t)(i % MAX_PROCESSES));
+			scheduleEvent(&events[i], nextRandom() % 100000);
+		}
+		sprintf(param, "pending=%u", counts[c]);
+
+		allocations = allocationCount;
+		t = nowNs();
+		for (i = 0; i < benchIterations; i++)
+		{
+			pEvent = peekNextEvent();
+			scheduleEvent(pEvent, pEvent->time + 1 + nextRandom() % 100000);
+		}
+		report("eventQueue/hold", param, benchIterations, nowNs() - t, allocationCount - allocations);
+		free(events);
+	}
+	initEventQueue(0);
+}
+
+static void benchCompaction(void)
+{	// compaction of k resident processes, each followed by a hole
+	// the memory size is fixed by MEMORY_SIZE, so the cost is measured
+	// against the number of resident processes and holes instead
+	static const unsigned counts[] = { 4, 32, 128, MEMORY_SIZE / 2 };
+	char param[32];
+	unsigned c, i, pid, size, pass;
+	unsigned long long allocations = 0;
+	double elapsed, t;
+	unsigned rounds = benchIterations / 100 + 1;
+
+	// second pass: 4 KiB per memory unit in the arena, the bytes are moved
+	for (pass = 0; pass < 2; pass++)
+	for (c = 0; c < sizeof(counts) / sizeof(counts[0]); c++)
+	{
+		arenaEnabled = (pass == 1);
+		arenaScale = 4096;
+		resetArena();
+		size = MEMORY_SIZE / (2 * counts[c]);
+		elapsed = 0.0;
+		allocations = 0;
+		for (i = 0; i < rounds; i++)
+		{	// rebuild the fragmented layout, not measured
+			resetFreeList(0, size);
+			for (pid = 1; pid <= counts[c]; pid++)
+			{
+				processTable[pid].valid = TRUE;
+				processTable[pid].status = running;
+				processTable[pid].pid = pid;
+				processTable[pid].size = size;
+				processTable[pid].start = (2 * pid - 1) * size;
+				if (pid < counts[c]) freeMemory(2 * pid * size, size);
+				arenaProcessPlaced(&processTable[pid]);
+			}
+			t = nowNs();
+			allocations -= allocationCount;
+			compactMemoryWithSimulation();
+			allocations += allocationCount;
+			elapsed += nowNs() - t;
+		}
+		sprintf(param, "resident=%u", counts[c]);
+		report(arenaEnabled ? "compactMemory/arena" : "compactMemoryWithSimulation", param,
+			rounds, elapsed, allocations);
+		for (pid = 0; pid < MAX_PROCESSES; pid++) processTable[pid].valid = FALSE;
+	}
+	arenaEnabled = FALSE;
+	resetFreeList(0, MEMORY_SIZE);
+}
+
+static void benchEndToEnd(void)
+{	// full simulation runs on generated traces, events are arrivals and completions
+	static const char* typeNames[] = { "os", "interactive", "batch", "background", "foreground" };
+	char param[32];
+	unsigned n, i, arrival;
+	unsigned long long allocations;
+	double t;
+	FILE* trace;
+
+	for (n = 1000; n <= maxTraceProcesses; n *= 10)
+	{
+		trace = tmpfile();
+		if (trace == NULL)
+		{
+			fprintf(stderr, "Cannot create temporary trace file\n");
+			return;
+		}
+		// offered load of about 80%: mean duration 250, mean interarrival 300
+		fprintf(trace, " # OwnerID start duration size type\n");
+		arrival = 0;
+		for (i = 0; i < n; i++)
+		{
+			arrival += nextRandom() % 601;
+			fprintf(trace, " %02u %u %u %u %s\n", nextRandom() % 10, arrival,
+				50 + nextRandom() % 401, 1 + nextRandom() % 200, typeNames[nextRandom() % 5]);
+		}
+		rewind(trace);
+		{	// skip the comment line, as openConfigFile() does
+			char linebuffer[129];
+			fgets(linebuffer, 128, trace);
+		}
+
+		processFile = trace;
+		systemTime = 0;
+		batchComplete = FALSE;
+		candidateProcess.valid = FALSE;
+		allocations = allocationCount;
+		t = nowNs();
+		coreLoop();			// closes the trace file at EOF
+		sprintf(param, "processes=%u", n);
+		report("coreLoop/events", param, 2ULL * n, nowNs() - t, allocationCount - allocations);
+		if (n > UINT_MAX / 10) break;
+	}
+}
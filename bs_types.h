@@ -5,7 +5,11 @@
 
 typedef enum {FALSE=0, TRUE} Boolean;
 
+#ifdef _WIN32
 typedef unsigned int pid_t; 
+#else
+#include <sys/types.h>		// POSIX already defines pid_t
+#endif
 
 /* data type for the possible types of processes */
 /* the process type determines the IO-characteristic */
@@ -40,11 +44,16 @@ typedef struct
 		pid_t ppid;
 		unsigned ownerID;
 		unsigned start; 
+		unsigned arrival;	// arrival time, kept when start becomes the memory address
 		unsigned duration; 
 		unsigned size; 
 		unsigned usedCPU; 
+		unsigned core;		// CPU core whose run queue holds the process
 		ProcessType_t type; 
 		Status_t status;
+		unsigned imageSegment;	// shared segments referenced, 0 = none (segment.c)
+		unsigned parentSegment;
+		unsigned sharedSize;	// units served by these segments, not part of size
 	} PCB_t; 
 
 typedef struct FreeBlock {
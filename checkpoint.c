@@ -0,0 +1,301 @@
+/* Implementation of checkpoint and restore of the simulation state */
+/* for comments on the functions see the associated .h-file */
+
+/* ---------------------------------------------------------------- */
+/* Include required external definitions */
+#include <limits.h>
+#include "globals.h"
+#include "checkpoint.h"
+#include "executer.h"
+#include "stats.h"
+#include "summary.h"
+#include "loader.h"
+#include "arena.h"
+#include "stream.h"
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+/* ----------------------------------------------------------------	*/
+/* Declarations of global variables visible only in this file 		*/
+static char checkpointTrace[CHECKPOINT_PATH_SIZE] = "";	// trace of the current run
+static const char* checkpointPattern = NULL;	// file name, "%u" is the system time
+static unsigned checkpointInterval = 0;		// time between two checkpoints, 0 = none
+static unsigned nextCheckpoint = 0;			// systemTime of the next due checkpoint
+static unsigned restorePolicies = 0;		// RESTORE_... the next restore takes from givenPolicy
+static CheckpointPolicy_t givenPolicy;		// policies of the command line of a restore
+
+/* ---------------------------------------------------------------- */
+/*                Declarations of local helper functions            */
+static void saveState(Checkpoint_t* pCheckpoint);
+static Boolean applyState(const Checkpoint_t* pCheckpoint);
+static void collectPolicies(CheckpointPolicy_t* pPolicy);
+static Boolean checkLayout(const CheckpointPolicy_t* pStored, unsigned given);
+static void applyPolicies(const CheckpointPolicy_t* pStored, unsigned given);
+static void scheduleNextCheckpoint(void);
+
+/* ---------------------------------------------------------------- */
+/*                Externally available functions                    */
+/* ---------------------------------------------------------------- */
+
+void setCheckpointOptions(const char* traceFilename, const char* filePattern, unsigned interval)
+{
+	strncpy(checkpointTrace, traceFilename, sizeof(checkpointTrace) - 1);
+	checkpointTrace[sizeof(checkpointTrace) - 1] = '\0';
+	checkpointPattern = filePattern;
+	checkpointInterval = interval;
+	scheduleNextCheckpoint();
+}
+
+void checkpointPeriodic(void)
+{
+	char filename[CHECKPOINT_PATH_SIZE + 16];
+	const char* placeholder;
+
+	if ((checkpointInterval == 0) || (systemTime < nextCheckpoint)) return;
+	placeholder = strstr(checkpointPattern, "%u");
+	if (placeholder == NULL) sprintf(filename, "%.*s", CHECKPOINT_PATH_SIZE, checkpointPattern);
+	else sprintf(filename, "%.*s%u%.*s", (int)(placeholder - checkpointPattern), checkpointPattern,
+		systemTime, CHECKPOINT_PATH_SIZE / 2, placeholder + 2);
+	if (!writeCheckpoint(filename))
+		fprintf(stderr, "Cannot write checkpoint %s\n", filename);
+	scheduleNextCheckpoint();
+}
+
+Boolean writeCheckpoint(const char* filename)
+{
+	Checkpoint_t* pCheckpoint;
+	FILE* f;
+	Boolean written;
+	char buffer[CHECKPOINT_PATH_SIZE + 32];
+
+	if (followInput || (strcmp(checkpointTrace, "-") == 0))
+	{	// the position in a feed cannot be found again
+		logGeneric("Checkpoint skipped: the trace is a live feed");
+		return FALSE;
+	}
+	// calloc, so that padding and unused entries are written as zeros
+	pCheckpoint = (Checkpoint_t*)calloc(1, sizeof(Checkpoint_t));
+	if (pCheckpoint == NULL) return FALSE;
+	saveState(pCheckpoint);
+	f = fopen(filename, "wb");
+	written = (f != NULL) && (fwrite(pCheckpoint, sizeof(Checkpoint_t), 1, f) == 1);
+	if ((f != NULL) && (fclose(f) != 0)) written = FALSE;
+	free(pCheckpoint);
+	if (written)
+	{
+		sprintf(buffer, "Checkpoint written to %.*s", CHECKPOINT_PATH_SIZE, filename);
+		logGeneric(buffer);
+	}
+	return written;
+}
+
+void setRestorePolicies(unsigned given)
+{
+	collectPolicies(&givenPolicy);
+	restorePolicies = given;
+}
+
+Boolean restoreCheckpoint(const char* filename)
+{
+	Boolean restored;
+	char buffer[CHECKPOINT_PATH_SIZE + 32];
+#ifdef _WIN32
+	Checkpoint_t* pCheckpoint;
+	FILE* f;
+
+	pCheckpoint = (Checkpoint_t*)malloc(sizeof(Checkpoint_t));
+	if (pCheckpoint == NULL) return FALSE;
+	f = fopen(filename, "rb");
+	restored = (f != NULL) && (fread(pCheckpoint, sizeof(Checkpoint_t), 1, f) == 1)
+		&& applyState(pCheckpoint);
+	if (f != NULL) fclose(f);
+	free(pCheckpoint);
+#else
+	// the checkpoint is used in place, no copy of the file is needed
+	const Checkpoint_t* pCheckpoint;
+	struct stat status;
+	int fd;
+
+	fd = open(filename, O_RDONLY);
+	if (fd < 0) return FALSE;
+	if ((fstat(fd, &status) != 0) || ((size_t)status.st_size < sizeof(Checkpoint_t)))
+	{
+		close(fd);
+		return FALSE;
+	}
+	pCheckpoint = (const Checkpoint_t*)mmap(NULL, sizeof(Checkpoint_t), PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (pCheckpoint == (const Checkpoint_t*)MAP_FAILED) return FALSE;
+	restored = applyState(pCheckpoint);
+	munmap((void*)pCheckpoint, sizeof(Checkpoint_t));
+#endif
+	if (restored)
+	{
+		sprintf(buffer, "Checkpoint %.*s restored", CHECKPOINT_PATH_SIZE, filename);
+		logGeneric(buffer);
+	}
+	return restored;
+}
+
+/* ----------------------------------------------------------------- */
+/*                       Local helper functions                      */
+/* ----------------------------------------------------------------- */
+
+static void saveState(Checkpoint_t* pCheckpoint)
+{
+	memcpy(pCheckpoint->magic, CHECKPOINT_MAGIC, sizeof(pCheckpoint->magic));
+	pCheckpoint->version = CHECKPOINT_VERSION;
+	pCheckpoint->size = sizeof(Checkpoint_t);
+
+	strcpy(pCheckpoint->sim.traceFilename, checkpointTrace);
+	// the trace is closed once it is read completely
+	pCheckpoint->sim.traceOffset = batchComplete ? 0 : loaderOffset();
+	pCheckpoint->sim.systemTime = systemTime;
+	pCheckpoint->sim.usedMemory = usedMemory;
+	pCheckpoint->sim.runningCount = runningCount;
+	pCheckpoint->sim.batchComplete = batchComplete;
+	pCheckpoint->sim.seed = simSeed;
+	pCheckpoint->sim.candidate = candidateProcess;
+
+	collectPolicies(&pCheckpoint->policy);
+
+	memcpy(pCheckpoint->processTable, processTable, sizeof(processTable));
+	saveCoreCheckpoint(pCheckpoint);
+	saveExecCheckpoint(pCheckpoint);
+	saveQuickFitCheckpoint(pCheckpoint);
+	saveStatsCheckpoint(pCheckpoint);
+	saveSummaryCheckpoint(pCheckpoint);
+	saveNumaCheckpoint(pCheckpoint);
+	saveAdmissionCheckpoint(pCheckpoint);
+	saveSegmentCheckpoint(pCheckpoint);
+}
+
+static Boolean applyState(const Checkpoint_t* pCheckpoint)
+{
+	unsigned given = restorePolicies;
+
+	restorePolicies = 0;		// for this restore only
+	if ((memcmp(pCheckpoint->magic, CHECKPOINT_MAGIC, sizeof(pCheckpoint->magic)) != 0)
+		|| (pCheckpoint->version != CHECKPOINT_VERSION)
+		|| (pCheckpoint->size != sizeof(Checkpoint_t)))
+	{
+		logGeneric("Checkpoint is invalid or was written by another build");
+		return FALSE;
+	}
+	if (!checkLayout(&pCheckpoint->policy, given)) return FALSE;
+	// the trace is needed first, nothing is changed if it is missing
+	batchComplete = pCheckpoint->sim.batchComplete;
+	if (!batchComplete)
+	{
+		processFile = fopen(pCheckpoint->sim.traceFilename, "r");
+		if ((processFile == NULL) || (fseek(processFile, (long)pCheckpoint->sim.traceOffset, SEEK_SET) != 0))
+		{
+			logGeneric("Trace of the checkpoint cannot be reopened");
+			if (processFile != NULL) fclose(processFile);
+			processFile = NULL;
+			return FALSE;
+		}
+	}
+	else processFile = NULL;
+	strcpy(checkpointTrace, pCheckpoint->sim.traceFilename);
+	systemTime = pCheckpoint->sim.systemTime;
+	usedMemory = pCheckpoint->sim.usedMemory;
+	runningCount = pCheckpoint->sim.runningCount;
+	simSeed = pCheckpoint->sim.seed;
+	srand(simSeed);
+	candidateProcess = pCheckpoint->sim.candidate;
+
+	applyPolicies(&pCheckpoint->policy, given);
+
+	memcpy(processTable, pCheckpoint->processTable, sizeof(processTable));
+	restoreCoreCheckpoint(pCheckpoint);		// before the statistics, they are derived from the free list
+	restoreExecCheckpoint(pCheckpoint);
+	restoreQuickFitCheckpoint(pCheckpoint);
+	restoreStatsCheckpoint(pCheckpoint);
+	restoreSummaryCheckpoint(pCheckpoint);
+	restoreNumaCheckpoint(pCheckpoint);
+	restoreAdmissionCheckpoint(pCheckpoint);
+	restoreSegmentCheckpoint(pCheckpoint);
+	resetArena();		// the arena is not stored, the patterns are written again
+	resetMemoryLog();	// the log continues with a full dump
+	scheduleNextCheckpoint();
+	return TRUE;
+}
+
+static void collectPolicies(CheckpointPolicy_t* pPolicy)
+{
+	pPolicy->quickFitEnabled = quickFitEnabled;
+	pPolicy->coreCount = coreCount;
+	pPolicy->nodeCount = nodeCount;
+	pPolicy->numaPolicy = numaPolicy;
+	pPolicy->remotePenalty = remotePenalty;
+	pPolicy->placementPolicy = placementPolicy;
+	pPolicy->smallThreshold = smallThreshold;
+	pPolicy->admissionPolicy = admissionPolicy;
+	pPolicy->admissionWindow = admissionWindow;
+	pPolicy->maxAdmissionDelay = maxAdmissionDelay;
+	memcpy(pPolicy->ownerQuota, ownerQuota, sizeof(ownerQuota));
+	memcpy(pPolicy->ownerWeight, ownerWeight, sizeof(ownerWeight));
+	pPolicy->sharedImagePercent = sharedImagePercent;
+	pPolicy->cowWritePercent = cowWritePercent;
+}
+
+static Boolean checkLayout(const CheckpointPolicy_t* pStored, unsigned given)
+{	// the running processes, run queues and segments were built for the
+	// stored layout, a given option may only repeat it
+	if ((given & RESTORE_CORES) && (givenPolicy.coreCount != pStored->coreCount))
+		fprintf(stderr, "--cores %u conflicts with the checkpoint, it was written with %u cores\n",
+			givenPolicy.coreCount, pStored->coreCount);
+	else if ((given & RESTORE_NODES) && (givenPolicy.nodeCount != pStored->nodeCount))
+		fprintf(stderr, "--nodes %u conflicts with the checkpoint, it was written with %u nodes\n",
+			givenPolicy.nodeCount, pStored->nodeCount);
+	else if ((given & RESTORE_NUMA) && ((givenPolicy.numaPolicy != pStored->numaPolicy)
+		|| (givenPolicy.remotePenalty != pStored->remotePenalty)))
+		fprintf(stderr, "--numa-policy and --remote-penalty must match the checkpoint\n");
+	else if ((given & RESTORE_SEGMENTS) && ((givenPolicy.sharedImagePercent != pStored->sharedImagePercent)
+		|| (givenPolicy.cowWritePercent != pStored->cowWritePercent)))
+		fprintf(stderr, "--shared-image %u and --cow-write %u conflict with the checkpoint, it was written with %u and %u\n",
+			givenPolicy.sharedImagePercent, givenPolicy.cowWritePercent,
+			pStored->sharedImagePercent, pStored->cowWritePercent);
+	else return TRUE;
+	return FALSE;
+}
+
+static void applyPolicies(const CheckpointPolicy_t* pStored, unsigned given)
+{	// the stored policies, except those given on the command line that may change
+	const CheckpointPolicy_t* pPolicy;
+
+	coreCount = pStored->coreCount;
+	nodeCount = pStored->nodeCount;
+	numaPolicy = pStored->numaPolicy;
+	remotePenalty = pStored->remotePenalty;
+	sharedImagePercent = pStored->sharedImagePercent;
+	cowWritePercent = pStored->cowWritePercent;
+
+	pPolicy = (given & RESTORE_QUICKFIT) ? &givenPolicy : pStored;
+	quickFitEnabled = pPolicy->quickFitEnabled;
+	pPolicy = (given & RESTORE_PLACEMENT) ? &givenPolicy : pStored;
+	placementPolicy = pPolicy->placementPolicy;
+	smallThreshold = pPolicy->smallThreshold;
+	pPolicy = (given & RESTORE_ADMISSION) ? &givenPolicy : pStored;
+	admissionPolicy = pPolicy->admissionPolicy;
+	pPolicy = (given & RESTORE_WINDOW) ? &givenPolicy : pStored;
+	admissionWindow = pPolicy->admissionWindow;
+	maxAdmissionDelay = pPolicy->maxAdmissionDelay;
+	pPolicy = (given & RESTORE_OWNERS) ? &givenPolicy : pStored;
+	memcpy(ownerQuota, pPolicy->ownerQuota, sizeof(ownerQuota));
+	memcpy(ownerWeight, pPolicy->ownerWeight, sizeof(ownerWeight));
+	if (given & (RESTORE_QUICKFIT | RESTORE_PLACEMENT | RESTORE_ADMISSION | RESTORE_WINDOW | RESTORE_OWNERS))
+		logGeneric("Checkpoint policies replaced by those given on the command line");
+}
+
+static void scheduleNextCheckpoint(void)
+{	// the next multiple of the interval after the current time
+	if (checkpointInterval == 0) return;
+	nextCheckpoint = (systemTime / checkpointInterval + 1) * checkpointInterval;
+	if (nextCheckpoint <= systemTime) nextCheckpoint = UINT_MAX;	// end of the time range
+}
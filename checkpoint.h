@@ -0,0 +1,209 @@
+/* Include-file defining checkpoint and restore of the simulation state		*/
+/* A checkpoint is one flat record of fixed size without pointers: linked	*/
+/* structures (free list, blocked queue, run queues) are stored as arrays	*/
+/* or pid links, so the file can be mapped into memory and read in place.	*/
+/* Checkpoints are taken between two iterations of the core loop; a run		*/
+/* resumed from a checkpoint continues exactly like the original run.		*/
+/* The layout depends on the build (type sizes, MAX_PROCESSES, ...), the	*/
+/* header detects a checkpoint of another build.							*/
+#ifndef __CHECKPOINT__
+#define __CHECKPOINT__
+
+#include "globals.h"
+#include "quickfit.h"
+#include "numa.h"
+#include "admission.h"
+#include "segment.h"
+
+#define CHECKPOINT_MAGIC	"MEMSIMCP"
+#define CHECKPOINT_VERSION	5
+#define CHECKPOINT_PATH_SIZE 256
+
+/* data type of a free block in a checkpoint */
+typedef struct
+	{
+		unsigned start;
+		unsigned size;
+	} CheckpointBlock_t;
+
+/* data type of the memory management policies of a run */
+typedef struct
+	{
+		Boolean quickFitEnabled;
+		unsigned coreCount;
+		unsigned nodeCount;
+		NumaPolicy_t numaPolicy;
+		unsigned remotePenalty;
+		PlacementPolicy_t placementPolicy;
+		unsigned smallThreshold;
+		AdmissionPolicy_t admissionPolicy;
+		unsigned admissionWindow;
+		unsigned maxAdmissionDelay;
+		unsigned ownerQuota[MAX_OWNERS];
+		unsigned ownerWeight[MAX_OWNERS];
+		unsigned sharedImagePercent;
+		unsigned cowWritePercent;
+	} CheckpointPolicy_t;
+
+/* policies given on the command line of a restore, see setRestorePolicies()	*/
+/* the first ones may change when a run continues, the others define the	*/
+/* layout of the run and must match the checkpoint							*/
+#define RESTORE_QUICKFIT	0x0001		// --quickfit
+#define RESTORE_PLACEMENT	0x0002		// --placement, --small-threshold
+#define RESTORE_ADMISSION	0x0004		// --admission
+#define RESTORE_WINDOW		0x0008		// --window, --max-delay
+#define RESTORE_OWNERS		0x0010		// --owner-quota, --owner-weight
+#define RESTORE_CORES		0x0020		// --cores
+#define RESTORE_NODES		0x0040		// --nodes
+#define RESTORE_NUMA		0x0080		// --numa-policy, --remote-penalty
+#define RESTORE_SEGMENTS	0x0100		// --shared-image, --cow-write
+
+/* data type of a checkpoint, every module saves and restores its section */
+typedef struct Checkpoint
+	{
+		char magic[8];					// CHECKPOINT_MAGIC, not terminated
+		unsigned version;				// CHECKPOINT_VERSION
+		unsigned size;					// sizeof(Checkpoint_t) of the writing build
+
+		struct {						// simulation environment, main.c and loader
+			char traceFilename[CHECKPOINT_PATH_SIZE];
+			long long traceOffset;		// position of the next process in the trace
+			unsigned systemTime;
+			unsigned usedMemory;
+			unsigned runningCount;
+			Boolean batchComplete;
+			unsigned seed;
+			PCB_t candidate;
+		} sim;
+
+		CheckpointPolicy_t policy;		// memory management policies
+
+		PCB_t processTable[MAX_PROCESSES];
+
+		struct {						// core.c
+			unsigned pidCounter;
+			unsigned freeBlockCount;
+			CheckpointBlock_t freeBlocks[MEMORY_SIZE];	// address order
+			unsigned blockedCount;
+			pid_t blocked[MAX_PROCESSES];	// queue order
+		} core;
+
+		struct {						// executer.c
+			pid_t runQueueHead[MAX_CORES];
+			unsigned runQueueLength[MAX_CORES];
+			pid_t runQueueNext[MAX_PROCESSES];
+			pid_t runQueuePrev[MAX_PROCESSES];
+			unsigned long long coreBusyTime[MAX_CORES];
+			unsigned coreCompleted[MAX_CORES];
+			unsigned migrationCount;
+			pid_t coreNextPid[MAX_CORES];
+			Boolean coreDirty[MAX_CORES];
+			unsigned long long coreClock[MAX_CORES];
+			unsigned long long finishTag[MAX_PROCESSES];
+			unsigned eventBaseTime;
+			Boolean completionQueued[MAX_CORES];
+			unsigned completionTime[MAX_CORES];
+			pid_t completionPid[MAX_CORES];
+			Boolean arrivalQueued;
+			unsigned arrivalTime;
+		} exec;
+
+		struct {						// quickfit.c
+			unsigned trackedSize[QUICKFIT_TRACKED];
+			unsigned trackedCount[QUICKFIT_TRACKED];
+			unsigned trackedUsed;
+			unsigned arrivalsSinceRelearn;
+			unsigned classSize[QUICKFIT_CLASSES];
+			unsigned classCount[QUICKFIT_CLASSES];
+			unsigned classStart[QUICKFIT_CLASSES][QUICKFIT_DEPTH];
+			unsigned releasesSinceFlush;
+			unsigned long long hits, misses, flushes;
+		} quickFit;
+
+		struct {						// stats.c, the free block counts are rebuilt
+			unsigned long long allocations;
+			unsigned long long failures;
+			unsigned compactions;
+			unsigned long long unitsMoved;
+			unsigned blockedCount;
+			unsigned long long usedIntegral;
+			unsigned lastUsedChange;
+			unsigned nextSnapshot;
+		} stats;
+
+		struct {						// summary.c
+			unsigned completedCount;
+			unsigned rejectedCount;
+			unsigned long long turnaroundTotal;
+			unsigned turnaroundMin;
+			unsigned turnaroundMax;
+			unsigned peakFragmentation;
+			unsigned peakFreeBlocks;
+		} summary;
+
+		struct {						// numa.c
+			unsigned interleaveNext;
+			unsigned nodeUsed[MAX_NODES];
+			unsigned long long nodeUsedIntegral[MAX_NODES];
+			unsigned lastChange;
+			unsigned peakFragmentation[MAX_NODES];
+			unsigned localPlacements[MAX_NODES];
+			unsigned remotePlacements[MAX_NODES];
+			unsigned long long penaltyTotal;
+		} numa;
+
+		struct {						// admission.c
+			unsigned rounds;
+			unsigned admittedCount;
+			unsigned overdueCount;
+			unsigned reservations;
+			unsigned long long waitTotal;
+			unsigned waitMax;
+			unsigned ownerAdmitted[MAX_OWNERS];
+			unsigned long long ownerWaitTotal[MAX_OWNERS];
+			unsigned ownerWaitMax[MAX_OWNERS];
+		} admission;
+
+		struct {						// segment.c
+			Segment_t segments[SEGMENT_MAX];
+			unsigned imageOf[SEGMENT_KEYS];
+			unsigned parentOf[SEGMENT_KEYS];
+			unsigned imageCount;
+			unsigned attachedCount;
+			unsigned childCount;
+			unsigned standaloneCount;
+			unsigned logicalUsed;
+			long long savedNow;
+			long long savedPeak;
+			long long savedIntegral;
+			unsigned lastSavedChange;
+		} segment;
+	} Checkpoint_t;
+
+
+void setCheckpointOptions(const char* traceFilename, const char* filePattern, unsigned interval);
+/* remembers the trace of the run and enables periodic checkpoints every	*/
+/* interval time units (0 = none). A "%u" in filePattern is replaced by		*/
+/* the system time of the checkpoint, otherwise the file is overwritten		*/
+
+void checkpointPeriodic(void);
+/* writes a checkpoint if one is due, called between two iterations of		*/
+/* the core loop															*/
+
+Boolean writeCheckpoint(const char* filename);
+/* writes the current state of the simulation to the given file			*/
+/* returns FALSE on error													*/
+
+void setRestorePolicies(unsigned given);
+/* takes the current policies for the RESTORE_... set in given, the next	*/
+/* restoreCheckpoint() applies them instead of the stored ones. Layout		*/
+/* policies that differ from the checkpoint make that restore fail			*/
+
+Boolean restoreCheckpoint(const char* filename);
+/* replaces the state of the simulation by the checkpoint in the given		*/
+/* file and reopens the trace at the stored position. The run is then		*/
+/* continued by resumeCoreLoop().											*/
+/* returns FALSE if the file cannot be read, stems from another build or	*/
+/* conflicts with the policies of setRestorePolicies()						*/
+
+#endif /* __CHECKPOINT__ */
@@ -0,0 +1,303 @@
+/* Implementation of the control socket of a running simulation */
+/* for comments on the functions see the associated .h-file */
+
+/* ---------------------------------------------------------------- */
+/* Include required external definitions */
+#include "globals.h"
+#include "control.h"
+#include "stats.h"
+#include "checkpoint.h"
+#ifndef _WIN32
+#define CONTROL_SOCKETS
+#include <signal.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0			// SIGPIPE is ignored instead
+#endif
+#endif
+
+#define CONTROL_POLL_MS 200		// the thread checks for its end this often
+
+#ifdef CONTROL_SOCKETS
+/* data type of a connection to the socket */
+typedef struct
+	{
+		int fd;
+		unsigned length;				// characters of an incomplete line
+		char line[CONTROL_LINE_SIZE];
+	} ControlClient_t;
+
+/* ----------------------------------------------------------------	*/
+/* Declarations of global variables visible only in this file 		*/
+// a command is passed from the thread to the core loop and back: the thread
+// sets requestPending, the core loop clears it when answerLine is filled
+static pthread_mutex_t requestLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t requestArrived = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t requestDone = PTHREAD_COND_INITIALIZER;
+static atomic_int requestPending;
+static atomic_int stopRequested;
+static char requestLine[CONTROL_LINE_SIZE];
+static char answerLine[CONTROL_LINE_SIZE];
+
+static pthread_t controlThread;
+static Boolean controlRunning = FALSE;
+static int listenFd = -1;
+static struct sockaddr_un socketAddress;
+static ControlClient_t clients[CONTROL_MAX_CLIENTS];
+static unsigned clientCount;
+
+static Boolean paused;					// the core loop waits for resume
+static unsigned long long eventCount;	// iterations of the core loop
+static unsigned long long lastStatusEvents;	// eventCount at the previous status
+static double lastStatusNs;				// and its time stamp
+
+/* ---------------------------------------------------------------- */
+/*                Declarations of local helper functions            */
+static void* serveSocket(void* argument);
+static Boolean readClient(ControlClient_t* pClient);
+static void submitCommand(ControlClient_t* pClient);
+static void serveRequest(void);
+static void executeCommand(const char* command, char* answer);
+#endif
+
+/* ---------------------------------------------------------------- */
+/*                Externally available functions                    */
+/* ---------------------------------------------------------------- */
+
+Boolean startControl(const char* path)
+{
+#ifdef CONTROL_SOCKETS
+	if (controlRunning) return TRUE;
+	if (strlen(path) >= sizeof(socketAddress.sun_path))
+	{
+		fprintf(stderr, "Control socket path too long: %s\n", path);
+		return FALSE;
+	}
+	memset(&socketAddress, 0, sizeof(socketAddress));
+	socketAddress.sun_family = AF_UNIX;
+	strcpy(socketAddress.sun_path, path);
+	listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listenFd < 0) return FALSE;
+	unlink(path);		// left over by a run that was killed
+	if ((bind(listenFd, (struct sockaddr*)&socketAddress, sizeof(socketAddress)) != 0)
+		|| (listen(listenFd, CONTROL_MAX_CLIENTS) != 0))
+	{
+		close(listenFd);
+		listenFd = -1;
+		return FALSE;
+	}
+	signal(SIGPIPE, SIG_IGN);	// a client may leave before its answer
+	atomic_store(&requestPending, 0);
+	atomic_store(&stopRequested, 0);
+	clientCount = 0;
+	paused = FALSE;
+	eventCount = 0;
+	lastStatusEvents = 0;
+	lastStatusNs = nowNs();
+	if (pthread_create(&controlThread, NULL, serveSocket, NULL) != 0)
+	{
+		close(listenFd);
+		listenFd = -1;
+		unlink(path);
+		return FALSE;
+	}
+	controlRunning = TRUE;
+	logGeneric("Sim: Control socket opened");
+	return TRUE;
+#else
+	fprintf(stderr, "The control socket is not available on this system\n");
+	return FALSE;
+#endif
+}
+
+void controlService(void)
+{
+#ifdef CONTROL_SOCKETS
+	if (!controlRunning) return;
+	eventCount++;
+	if (!atomic_load_explicit(&requestPending, memory_order_acquire)) return;
+	serveRequest();
+	while (paused)
+	{	// nothing but commands until resume
+		pthread_mutex_lock(&requestLock);
+		while (!atomic_load(&requestPending) && !atomic_load(&stopRequested))
+			pthread_cond_wait(&requestArrived, &requestLock);
+		pthread_mutex_unlock(&requestLock);
+		if (atomic_load(&requestPending)) serveRequest();
+		else paused = FALSE;
+	}
+#endif
+}
+
+void stopControl(void)
+{
+#ifdef CONTROL_SOCKETS
+	if (!controlRunning) return;
+	pthread_mutex_lock(&requestLock);
+	atomic_store(&stopRequested, 1);
+	pthread_cond_broadcast(&requestDone);	// a waiting command is answered by the thread
+	pthread_mutex_unlock(&requestLock);
+	pthread_join(controlThread, NULL);
+	close(listenFd);
+	listenFd = -1;
+	unlink(socketAddress.sun_path);
+	controlRunning = FALSE;
+#endif
+}
+
+/* ----------------------------------------------------------------- */
+/*                       Local helper functions                      */
+/* ----------------------------------------------------------------- */
+
+#ifdef CONTROL_SOCKETS
+static void* serveSocket(void* argument)
+{	// the thread: accepts connections and passes their commands on
+	struct pollfd fds[CONTROL_MAX_CLIENTS + 1];
+	unsigned i;
+	int fd;
+
+	(void)argument;
+	while (!atomic_load(&stopRequested))
+	{
+		fds[0].fd = listenFd;
+		fds[0].events = POLLIN;
+		for (i = 0; i < clientCount; i++)
+		{
+			fds[i + 1].fd = clients[i].fd;
+			fds[i + 1].events = POLLIN;
+		}
+		if (poll(fds, clientCount + 1, CONTROL_POLL_MS) <= 0) continue;
+		// clients first, a new one would shift the indices
+		for (i = clientCount; i > 0; i--)
+		{
+			if ((fds[i].revents == 0) || readClient(&clients[i - 1])) continue;
+			close(clients[i - 1].fd);
+			clients[i - 1] = clients[--clientCount];
+		}
+		if (fds[0].revents & POLLIN)
+		{
+			fd = accept(listenFd, NULL, NULL);
+			if (fd < 0) continue;
+			if (clientCount == CONTROL_MAX_CLIENTS)
+			{
+				send(fd, "error too many connections\n", 27, MSG_NOSIGNAL);
+				close(fd);
+				continue;
+			}
+			clients[clientCount].fd = fd;
+			clients[clientCount].length = 0;
+			clientCount++;
+		}
+	}
+	for (i = 0; i < clientCount; i++) close(clients[i].fd);
+	clientCount = 0;
+	return NULL;
+}
+
+static Boolean readClient(ControlClient_t* pClient)
+{	// returns FALSE once the connection is closed
+	char buffer[CONTROL_LINE_SIZE];
+	ssize_t count, i;
+
+	count = recv(pClient->fd, buffer, sizeof(buffer), 0);
+	if (count <= 0) return FALSE;
+	for (i = 0; i < count; i++)
+	{
+		if ((buffer[i] == '\n') || (pClient->length == CONTROL_LINE_SIZE - 1))
+		{	// a complete line, overlong ones are cut
+			if ((pClient->length > 0) && (pClient->line[pClient->length - 1] == '\r')) pClient->length--;
+			pClient->line[pClient->length] = '\0';
+			submitCommand(pClient);
+			pClient->length = 0;
+		}
+		else pClient->line[pClient->length++] = buffer[i];
+	}
+	return TRUE;
+}
+
+static void submitCommand(ControlClient_t* pClient)
+{	// hands the command to the core loop and sends its answer
+	char answer[CONTROL_LINE_SIZE + 1];
+
+	pthread_mutex_lock(&requestLock);
+	strcpy(requestLine, pClient->line);
+	atomic_store_explicit(&requestPending, 1, memory_order_release);
+	pthread_cond_signal(&requestArrived);
+	while (atomic_load(&requestPending) && !atomic_load(&stopRequested))
+		pthread_cond_wait(&requestDone, &requestLock);
+	if (atomic_load(&requestPending)) strcpy(answer, "error simulation ended");
+	else strcpy(answer, answerLine);
+	pthread_mutex_unlock(&requestLock);
+	strcat(answer, "\n");
+	send(pClient->fd, answer, strlen(answer), MSG_NOSIGNAL);
+}
+
+static void serveRequest(void)
+{	// on the thread of the core loop
+	executeCommand(requestLine, answerLine);
+	pthread_mutex_lock(&requestLock);
+	atomic_store_explicit(&requestPending, 0, memory_order_release);
+	pthread_cond_signal(&requestDone);
+	pthread_mutex_unlock(&requestLock);
+}
+
+static void executeCommand(const char* command, char* answer)
+{
+	char name[16], argument[CONTROL_LINE_SIZE];
+	MemoryStats_t stats;
+	double now;
+	int fields;
+
+	fields = sscanf(command, "%15s %200s", name, argument);
+	if (fields < 1)
+		strcpy(answer, "error empty command");
+	else if (strcmp(name, "status") == 0)
+	{
+		getStats(&stats);
+		now = nowNs();
+		sprintf(answer, "ok time %u used %u running %u blocked %u free %u free_blocks %u "
+			"largest_free %u fragmentation %u events %llu events_per_sec %.0f paused %u",
+			systemTime, usedMemory, runningCount, stats.blocked, stats.totalFree, stats.freeBlocks,
+			stats.largestFree, stats.fragmentation, eventCount,
+			(now > lastStatusNs) ? (double)(eventCount - lastStatusEvents) * 1e9 / (now - lastStatusNs) : 0.0,
+			paused ? 1U : 0U);
+		lastStatusEvents = eventCount;
+		lastStatusNs = now;
+	}
+	else if (strcmp(name, "pause") == 0)
+	{
+		paused = TRUE;
+		sprintf(answer, "ok paused at %u", systemTime);
+	}
+	else if (strcmp(name, "resume") == 0)
+	{
+		paused = FALSE;
+		sprintf(answer, "ok resumed at %u", systemTime);
+	}
+	else if (strcmp(name, "checkpoint") == 0)
+	{
+		if (fields < 2) strcpy(answer, "error checkpoint needs a file name");
+		else if (writeCheckpoint(argument)) sprintf(answer, "ok checkpoint %s at %u", argument, systemTime);
+		else sprintf(answer, "error cannot write checkpoint %s", argument);
+	}
+	else if (strcmp(name, "loglevel") == 0)
+	{
+		if ((fields < 2) || (argument[0] < '0') || (argument[0] > '0' + LOG_LEVEL_DEBUG) || (argument[1] != '\0'))
+			sprintf(answer, "error loglevel must be 0 to %u", LOG_LEVEL_DEBUG);
+		else
+		{
+			logLevel = (unsigned)(argument[0] - '0');
+			sprintf(answer, "ok loglevel %u", logLevel);
+		}
+	}
+	else if (strcmp(name, "help") == 0)
+		strcpy(answer, "ok commands: status, pause, resume, checkpoint <file>, loglevel <n>, help");
+	else
+		sprintf(answer, "error unknown command %s", name);
+}
+#endif
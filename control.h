@@ -0,0 +1,34 @@
+/* Include-file defining the control socket of a running simulation			*/
+/* A Unix domain stream socket accepts one command per line and answers		*/
+/* with one line starting with "ok" or "error":								*/
+/*   status              system time, memory, processes, free blocks,		*/
+/*                       events and events per second						*/
+/*   pause / resume      stops and continues the core loop					*/
+/*   checkpoint <file>   writes a checkpoint of the current state			*/
+/*   loglevel <n>        changes the verbosity of the log					*/
+/*   help                lists the commands									*/
+/* The socket is served by a thread of its own. A command is handed over	*/
+/* to the core loop, which executes it between two iterations, so every		*/
+/* answer reflects a consistent state. Per iteration the core loop only		*/
+/* checks one flag. Only available on POSIX systems.						*/
+#ifndef __CONTROL__
+#define __CONTROL__
+
+#include "bs_types.h"
+
+#define CONTROL_MAX_CLIENTS		8		// connections served at the same time
+#define CONTROL_LINE_SIZE		256		// longest command and answer
+
+
+Boolean startControl(const char* path);
+/* creates the socket at the given path, replacing a stale one, and starts	*/
+/* the thread serving it. Returns FALSE if the socket cannot be created		*/
+
+void controlService(void);
+/* executes a pending command, called between two iterations of the core	*/
+/* loop. Blocks while the simulation is paused								*/
+
+void stopControl(void);
+/* answers a pending command, stops the thread and removes the socket		*/
+
+#endif /* __CONTROL__ */
@@ -1,4 +1,19 @@
+#include <limits.h>
 #include "globals.h"
+#include "loader.h"
+#include "executer.h"
+#include "summary.h"
+#include "stats.h"
+#include "quickfit.h"
+#include "numa.h"
+#include "checkpoint.h"
+#include "arena.h"
+#include "admission.h"
+#include "probe.h"
+#include "control.h"
+#include "segment.h"
+#include "stream.h"
+#include "shard.h"
 
 /* ---------------------------------------------------------------- */
 /* Declarations of global variables visible only in this file       */
@@ -9,6 +24,16 @@ PCB_t* pNewProcess; // pointer for new process read from batch
 FreeBlock_t* freeList = NULL;
 BlockedProcess_t* blockedQueue = NULL;
 
+static unsigned pidCounter = 0;	// last pid handed out by getNextPid()
+
+PlacementPolicy_t placementPolicy = placementFirstFit;
+unsigned smallThreshold = PLACEMENT_DEFAULT_THRESHOLD;
+
+/* ---------------------------------------------------------------- */
+/*                Declarations of local helper functions            */
+static Boolean findFreeBlockInRange(unsigned size, unsigned low, unsigned high, unsigned* pStart);
+static void startWaitingProcesses(void);
+
 /* ---------------------------------------------------------------- */
 /*                Externally available functions                    */
 /* ---------------------------------------------------------------- */
@@ -16,52 +41,159 @@ BlockedProcess_t* blockedQueue = NULL;
 void initOS(void)
 {
     unsigned i; // iteration variable
+    FreeBlock_t* last = NULL;
 
     /* init the status of the OS */
     // mark all process entries invalid
     for (i = 0; i < MAX_PROCESSES; i++) processTable[i].valid = FALSE;
     process.pid = 0; // reset pid
-    freeList = (FreeBlock_t*)malloc(sizeof(FreeBlock_t));
-    logGeneric("New consolidated free block created with total size: ");
-    if (freeList == NULL) {
-        fprintf(stderr, "Memory allocation failed\n");
-        exit(1);
+    pidCounter = 0;
+    usedMemory = 0;
+    runningCount = 0;
+
+    // release the structures of a previous run, so repeated runs start identical
+    while (freeList != NULL) {
+        FreeBlock_t* temp = freeList;
+        freeList = freeList->next;
+        free(temp);
+    }
+    while (dequeueBlockedProcess() != NULL);
+    initCores();
+    resetQuickFit();
+    resetStats();
+    resetNuma();
+    resetArena();
+    resetAdmission();
+    resetSegments();
+    resetProbes();
+    resetMemoryLog();
+
+    // one free block per memory node, they are never merged
+    for (i = 0; i < nodeCount; i++) {
+        FreeBlock_t* block = (FreeBlock_t*)malloc(sizeof(FreeBlock_t));
+        if (block == NULL) {
+            fprintf(stderr, "Memory allocation failed\n");
+            exit(1);
+        }
+        block->start = nodeBase(i);
+        block->size = nodeSize(i);
+        block->next = NULL;
+        if (last == NULL) freeList = block;
+        else last->next = block;
+        last = block;
+        statsBlockAdded(block->size);
     }
-    freeList->start = 0;
-    freeList->size = MEMORY_SIZE;
-    freeList->next = NULL;
+    logGeneric("New consolidated free block created with total size of the memory");
+    resetSummary();
+}
+
+Boolean parsePlacementPolicy(const char* name) {
+    if (strcmp(name, "first-fit") == 0) placementPolicy = placementFirstFit;
+    else if (strcmp(name, "two-ended") == 0) placementPolicy = placementTwoEnded;
+    else return FALSE;
+    return TRUE;
+}
+
+Boolean findFreeBlock(unsigned size, unsigned* pStart) {
+    Boolean found;
+    PROBE_BEGIN(probeFindFreeBlock);
+    // the whole free list, the benchmarks build lists beyond MEMORY_SIZE
+    found = findFreeBlockInRange(size, 0, UINT_MAX, pStart);
+    PROBE_END(probeFindFreeBlock);
+    return found;
+}
+
+Boolean findFreeBlockOnNode(unsigned size, unsigned node, unsigned* pStart) {
+    Boolean found;
+    PROBE_BEGIN(probeFindFreeBlock);
+    found = findFreeBlockInRange(size, nodeBase(node), nodeBase(node + 1), pStart);
+    PROBE_END(probeFindFreeBlock);
+    return found;
 }
 
-FreeBlock_t* findFreeBlock(unsigned size) {
+static Boolean findFreeBlockInRange(unsigned size, unsigned low, unsigned high, unsigned* pStart) {
     FreeBlock_t* current = freeList;
     FreeBlock_t* previous = NULL;
+    FreeBlock_t* highest = NULL;
+    FreeBlock_t* beforeHighest = NULL;
+    char buffer[100];
 
+    if (placementPolicy == placementTwoEnded && size < smallThreshold) {
+        // small request: the last suitable block, cut from its upper end
+        while (current != NULL && current->start < high) {
+            if (current->start >= low && current->size >= size) {
+                highest = current;
+                beforeHighest = previous;
+            }
+            previous = current;
+            current = current->next;
+        }
+        if (highest != NULL) {
+            sprintf(buffer, "Suitable block found at the high end: Start = %u, Size = %u",
+                highest->start, highest->size);
+            logGeneric(buffer);
+            *pStart = highest->start + highest->size - size;
+            statsAllocation(TRUE);
+            statsBlockRemoved(highest->size);
+            if (highest->size == size) {
+                logBlockChange(memoryBlockTaken, highest->start, highest->size, 0, 0);
+                if (beforeHighest == NULL) {
+                    freeList = highest->next;
+                }
+                else {
+                    beforeHighest->next = highest->next;
+                }
+                free(highest);
+            }
+            else {
+                logBlockChange(memoryBlockSplit, highest->start, highest->size,
+                    highest->start, highest->size - size);
+                highest->size -= size;
+                statsBlockAdded(highest->size);
+            }
+            return TRUE;
+        }
+        current = NULL;     // nothing suitable, reported below
+    }
 
-    while (current != NULL) {
-        if (current->size >= size) {
-            logGeneric("Suitable block found during search: Start = " + current->start + current->size);
+    while (current != NULL && current->start < high) {
+        if (current->start >= low && current->size >= size) {
+            sprintf(buffer, "Suitable block found during search: Start = %u, Size = %u",
+                current->start, current->size);
+            logGeneric(buffer);
+            *pStart = current->start;
+            statsAllocation(TRUE);
+            statsBlockRemoved(current->size);
             if (current->size == size) {
+                logBlockChange(memoryBlockTaken, current->start, current->size, 0, 0);
                 if (previous == NULL) {
                     freeList = current->next;
                 }
                 else {
                     previous->next = current->next;
                 }
+                free(current);
             }
             else {
+                logBlockChange(memoryBlockSplit, current->start, current->size,
+                    current->start + size, current->size - size);
                 current->start += size;
                 current->size -= size;
+                statsBlockAdded(current->size);
             }
-            return current;
+            return TRUE;
         }
         previous = current;
         current = current->next;
     }
-    logGeneric("No suitable block found for size: " + size);
-    return NULL;
+    statsAllocation(FALSE);
+    sprintf(buffer, "No suitable block found for size: %u", size);
+    logGeneric(buffer);
+    return FALSE;
 }
 
 void freeMemory(unsigned start, unsigned size) {
+    PROBE_BEGIN(probeFreeMemory);
     FreeBlock_t* newBlock = (FreeBlock_t*)malloc(sizeof(FreeBlock_t));
     if (!newBlock) {
         fprintf(stderr, "Memory allocation failed in freeMemory.\n");
@@ -90,29 +222,88 @@ void freeMemory(unsigned start, unsigned size) {
     else {
         previous->next = newBlock;
     }
-
-    if (newBlock->next != NULL && newBlock->start + newBlock->size == newBlock->next->start) {
+    statsBlockAdded(newBlock->size);
+    logBlockChange(memoryBlockFreed, start, size, 0, 0);
+
+    // blocks of different nodes stay separate even if they are adjacent
+    if (newBlock->next != NULL && newBlock->start + newBlock->size == newBlock->next->start
+        && nodeOf(newBlock->start) == nodeOf(newBlock->next->start)) {
+        statsBlockRemoved(newBlock->size);
+        statsBlockRemoved(newBlock->next->size);
         newBlock->size += newBlock->next->size;
+        statsBlockAdded(newBlock->size);
+        logBlockChange(memoryBlockMerged, newBlock->start, newBlock->size, 0, 0);
         FreeBlock_t* temp = newBlock->next;
         newBlock->next = temp->next;
         free(temp);
         logGeneric("Adjacent blocks merged (next)");
     }
     
-    if (previous != NULL && previous->start + previous->size == newBlock->start) {
+    if (previous != NULL && previous->start + previous->size == newBlock->start
+        && nodeOf(previous->start) == nodeOf(newBlock->start)) {
+        statsBlockRemoved(previous->size);
+        statsBlockRemoved(newBlock->size);
         previous->size += newBlock->size;
+        statsBlockAdded(previous->size);
+        logBlockChange(memoryBlockMerged, previous->start, previous->size, 0, 0);
         previous->next = newBlock->next;
         free(newBlock);
         logGeneric("Adjacent blocks merged (previous)");
     }
 
     logMemoryState();
+    PROBE_END(probeFreeMemory);
 }
+
+Boolean allocateMemory(unsigned size, unsigned home, unsigned* pStart) {
+    unsigned order[MAX_NODES];
+    unsigned count = placementOrder(home, order);
+    unsigned i;
+
+    if (tryAllocateMemory(size, home, pStart)) {
+        return TRUE;
+    }
+    // the missing memory may sit in the quick-fit caches
+    if (quickFitFlush() > 0) {
+        logGeneric("Quick-fit caches flushed to serve the request");
+        for (i = 0; i < count; i++) {
+            if (findFreeBlockOnNode(size, order[i], pStart)) {
+                return TRUE;
+            }
+        }
+    }
+    return FALSE;
+}
+
+Boolean tryAllocateMemory(unsigned size, unsigned home, unsigned* pStart) {
+    unsigned order[MAX_NODES];
+    unsigned count = placementOrder(home, order);
+    unsigned i;
+
+    for (i = 0; i < count; i++) {
+        if (quickFitAllocate(size, order[i], pStart)) {
+            return TRUE;
+        }
+        if (findFreeBlockOnNode(size, order[i], pStart)) {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+void releaseMemory(unsigned start, unsigned size) {
+    if (!quickFitRelease(start, size)) {
+        freeMemory(start, size);
+    }
+}
+
 void enqueueBlockedProcessWithPriority(PCB_t* process) {
     BlockedProcess_t* newBlocked = (BlockedProcess_t*)malloc(sizeof(BlockedProcess_t));
     newBlocked->process = process;
     newBlocked->next = NULL;
 
+    statsBlockedEnqueued();
+    ownerProcessQueued(process);
     if (blockedQueue == NULL || process->size < blockedQueue->process->size) {
         newBlocked->next = blockedQueue;
         blockedQueue = newBlocked;
@@ -127,7 +318,7 @@ void enqueueBlockedProcessWithPriority(PCB_t* process) {
     }
 }
 
-PCB_t* dequeueBlockedProcess() {
+PCB_t* dequeueBlockedProcess(void) {
     if (blockedQueue == NULL) {
         return NULL;
     }
@@ -135,80 +326,247 @@ PCB_t* dequeueBlockedProcess() {
     PCB_t* process = temp->process;
     blockedQueue = blockedQueue->next;
     free(temp);
+    statsBlockedDequeued();
+    ownerProcessUnqueued(process);
     return process;
 }
 
-void compactMemoryWithSimulation() {
+Boolean removeBlockedProcess(PCB_t* process) {
+    BlockedProcess_t* current = blockedQueue;
+    BlockedProcess_t* previous = NULL;
+
+    while (current != NULL && current->process != process) {
+        previous = current;
+        current = current->next;
+    }
+    if (current == NULL) {
+        return FALSE;
+    }
+    if (previous == NULL) {
+        blockedQueue = current->next;
+    }
+    else {
+        previous->next = current->next;
+    }
+    free(current);
+    statsBlockedDequeued();
+    ownerProcessUnqueued(process);
+    return TRUE;
+}
+
+Boolean claimFreeRange(unsigned start, unsigned size) {
+    FreeBlock_t* current = freeList;
+    FreeBlock_t* previous = NULL;
+
+    while (current != NULL && current->start + current->size <= start) {
+        previous = current;
+        current = current->next;
+    }
+    if (current == NULL || current->start > start || start + size > current->start + current->size) {
+        return FALSE;
+    }
+    statsAllocation(TRUE);
+    statsBlockRemoved(current->size);
+    if (current->start < start) {
+        logBlockChange(memoryBlockSplit, current->start, current->size,
+            current->start, start - current->start);
+    }
+    else if (current->start + current->size > start + size) {
+        logBlockChange(memoryBlockSplit, current->start, current->size,
+            start + size, current->start + current->size - start - size);
+    }
+    else {
+        logBlockChange(memoryBlockTaken, current->start, current->size, 0, 0);
+    }
+    if (current->start + current->size > start + size) {
+        // the part above the range stays free
+        FreeBlock_t* upper = (FreeBlock_t*)malloc(sizeof(FreeBlock_t));
+        if (!upper) {
+            fprintf(stderr, "Memory allocation failed in claimFreeRange.\n");
+            exit(1);
+        }
+        upper->start = start + size;
+        upper->size = current->start + current->size - upper->start;
+        upper->next = current->next;
+        current->next = upper;
+        statsBlockAdded(upper->size);
+        if (current->start < start) {
+            // the split above kept the lower part
+            logBlockChange(memoryBlockFreed, upper->start, upper->size, 0, 0);
+        }
+    }
+    if (current->start < start) {
+        // the part below the range stays free
+        current->size = start - current->start;
+        statsBlockAdded(current->size);
+    }
+    else {
+        if (previous == NULL) {
+            freeList = current->next;
+        }
+        else {
+            previous->next = current->next;
+        }
+        free(current);
+    }
+    return TRUE;
+}
+
+void placeProcess(PCB_t* pProcess, unsigned start) {
+    summaryMemoryChanged();
+    pProcess->start = start;
+    logProcessChange(memoryPlaced, pProcess->pid, start, pProcess->size, 0);
+    numaProcessPlaced(pProcess);
+    ownerProcessPlaced(pProcess);
+    arenaProcessPlaced(pProcess);
+    pProcess->status = running;
+    statsUsedMemoryChanging();
+    usedMemory += pProcess->size;
+    segmentProcessPlaced(pProcess);
+    assignProcessToCore(pProcess->pid);
+    runningCount++;
+}
+
+void compactMemoryWithSimulation(void) {
+    PROBE_BEGIN(probeCompaction);
     logGeneric("Starting memory compaction...");
+    quickFitFlush();       // cached blocks are free memory, too
     logMemoryState();
 
     if (freeList == NULL || freeList->next == NULL) {
         logGeneric("Compaction skipped: no fragmentation");
+        PROBE_END(probeCompaction);
         return;
     }
 
-    unsigned nextFreeStart = 0;
+    // every node is compacted on its own, processes stay on their node
+    // the free memory of a node ends up between nextFreeStart and nextFreeEnd
+    unsigned nextFreeStart[MAX_NODES];
+    unsigned nextFreeEnd[MAX_NODES];
     unsigned totalCopyCost = 0;
+    unsigned node, target;
+    static ArenaMove_t moves[MAX_PROCESSES];    // relocations for the arena
+    unsigned moveCount = 0;
 
+    for (node = 0; node < nodeCount; node++) {
+        nextFreeStart[node] = nodeBase(node);
+        nextFreeEnd[node] = nodeBase(node + 1);
+    }
     for (unsigned i = 0; i < MAX_PROCESSES; i++) {
         if (processTable[i].valid && processTable[i].status == running) {
-            if (processTable[i].start != nextFreeStart) {
+            node = nodeOf(processTable[i].start);
+            if (placementPolicy == placementTwoEnded && processTable[i].size < smallThreshold) {
+                nextFreeEnd[node] -= processTable[i].size;
+                target = nextFreeEnd[node];
+            }
+            else {
+                target = nextFreeStart[node];
+                nextFreeStart[node] += processTable[i].size;
+            }
+            if (processTable[i].start != target) {
                 char buffer[100];
                 sprintf(buffer, "Moving process %u from %u to %u",
-                    processTable[i].pid, processTable[i].start, nextFreeStart);
+                    processTable[i].pid, processTable[i].start, target);
                 logGeneric(buffer);
 
                 totalCopyCost += processTable[i].size;
-                processTable[i].start = nextFreeStart;
+                moves[moveCount].pid = processTable[i].pid;
+                moves[moveCount].from = processTable[i].start;
+                moves[moveCount].to = target;
+                moves[moveCount].size = processTable[i].size;
+                moveCount++;
+                logProcessChange(memoryMoved, processTable[i].pid, processTable[i].start,
+                    processTable[i].size, target);
+                processTable[i].start = target;
             }
-            nextFreeStart += processTable[i].size;
         }
     }
 
+    totalCopyCost += segmentCompact(nextFreeStart);
+
     // Create new consolidated free block
+    logBlockChange(memoryBlocksCleared, 0, 0, 0, 0);
     while (freeList != NULL) {
         FreeBlock_t* temp = freeList;
         freeList = freeList->next;
+        statsBlockRemoved(temp->size);
         free(temp);
     }
 
-    freeList = (FreeBlock_t*)malloc(sizeof(FreeBlock_t));
-    if (!freeList) {
-        fprintf(stderr, "Memory allocation failed during compaction.\n");
-        exit(1);
+    FreeBlock_t* last = NULL;
+    for (node = 0; node < nodeCount; node++) {
+        if (nextFreeStart[node] == nextFreeEnd[node]) continue;    // node is full
+        FreeBlock_t* block = (FreeBlock_t*)malloc(sizeof(FreeBlock_t));
+        if (!block) {
+            fprintf(stderr, "Memory allocation failed during compaction.\n");
+            exit(1);
+        }
+        block->start = nextFreeStart[node];
+        block->size = nextFreeEnd[node] - nextFreeStart[node];
+        block->next = NULL;
+        if (last == NULL) freeList = block;
+        else last->next = block;
+        last = block;
+        statsBlockAdded(block->size);
+        logBlockChange(memoryBlockFreed, block->start, block->size, 0, 0);
     }
-    freeList->start = nextFreeStart;
-    freeList->size = MEMORY_SIZE - nextFreeStart;
-    freeList->next = NULL;
+    arenaCompact(moves, moveCount);
+    statsCompaction(totalCopyCost);
 
     char buffer[100];
     sprintf(buffer, "Compaction complete - Moved %u bytes, new free block at %u",
-        totalCopyCost, nextFreeStart);
+        totalCopyCost, nextFreeStart[0]);
     logGeneric(buffer);
 
     logMemoryState();
+    PROBE_END(probeCompaction);
 }
 
 
 
-void coreLoop(void) {
-    pid_t newPid;
-    SchedulingEvent_t nextEvent;
-    unsigned delta;
-    unsigned eventPid;
-    Boolean isLaunchable = FALSE;
+static void startWaitingProcesses(void) {
+    // blocked processes for fifo admission, an admission round otherwise
+    PCB_t* blockedProcess;
+    unsigned blockStart;
 
+    if (admissionPolicy != admissionFifo) {
+        admitWaitingProcesses();
+    }
+    else while ((blockedProcess = dequeueBlockedProcess()) != NULL) {
+        if (allocateMemory(blockedProcess->size, homeNode(blockedProcess), &blockStart)) {
+            placeProcess(blockedProcess, blockStart);
+            logPid(blockedProcess->pid, "Blocked process started");
+        }
+        else {
+            enqueueBlockedProcessWithPriority(blockedProcess);
+            break;
+        }
+    }
+}
+
+void coreLoop(void) {
     // 1. Initialize
     initOS();
     logGeneric("Process info file opened");
     logGeneric("System initialized, starting batch");
+    resumeCoreLoop();
+}
+
+void resumeCoreLoop(void) {
+    pid_t newPid;
+    SchedulingEvent_t nextEvent;
+    unsigned delta;
+    pid_t eventPid;
+    unsigned blockStart;
+    Boolean isLaunchable = FALSE;
 
     do {
         // 2. Check for new process
         if (checkForProcessInBatch()) {
             logGeneric("Reading next process from batch");
 
-            if (isNewProcessReady()) {
+            // with a full process table the start is deferred until a process ends
+            if (isNewProcessReady() && isPidAvailable()) {
                 isLaunchable = TRUE;
                 newPid = getNextPid();
                 PCB_t* pNewProcess = getNewPCBptr();
@@ -217,22 +575,34 @@ void coreLoop(void) {
                     logLoadedProcessData(pNewProcess);
 
                     if (initNewProcess(newPid, pNewProcess)) {
+                        quickFitObserve(processTable[newPid].size);
                         // Memory checks and allocation
-                        if (processTable[newPid].size <= MEMORY_SIZE) {
-                            if (usedMemory + processTable[newPid].size <= MEMORY_SIZE) {
-                                FreeBlock_t* block = findFreeBlock(processTable[newPid].size);
+                        // a process must fit into a single node it may be placed on
+                        if (processTable[newPid].size <= largestPlacement(&processTable[newPid])) {
+                            segmentAttach(&processTable[newPid]);
+                            if (admissionPolicy != admissionFifo) {
+                                processTable[newPid].status = ready;
+                                enqueueBlockedProcessWithPriority(&processTable[newPid]);
+                                logPid(processTable[newPid].pid, "Process waiting for admission round");
+                                // the arrivals of one instant are packed together
+                                checkForProcessInBatch();
+                                if (!(candidateProcess.valid && isNewProcessReady() && isPidAvailable())) {
+                                    admitWaitingProcesses();
+                                }
+                            }
+                            else if (usedMemory + processTable[newPid].size <= MEMORY_SIZE) {
+                                Boolean found = allocateMemory(processTable[newPid].size,
+                                    homeNode(&processTable[newPid]), &blockStart);
 
-                                if (block == NULL) {
+                                if (!found) {
                                     logGeneric("No suitable block found - attempting compaction");
                                     compactMemoryWithSimulation();
-                                    block = findFreeBlock(processTable[newPid].size);
+                                    found = allocateMemory(processTable[newPid].size,
+                                        homeNode(&processTable[newPid]), &blockStart);
                                 }
 
-                                if (block != NULL) {
-                                    processTable[newPid].start = block->start;
-                                    processTable[newPid].status = running;
-                                    usedMemory += processTable[newPid].size;
-                                    runningCount++;
+                                if (found) {
+                                    placeProcess(&processTable[newPid], blockStart);
                                     systemTime += LOADING_DURATION;
                                     logPidMem(processTable[newPid].pid, "Process started and memory allocated");
                                     flagNewProcessStarted();
@@ -250,7 +620,8 @@ void coreLoop(void) {
                             }
                         }
                         else {
-                            logPid(processTable[newPid].pid, "Process rejected - exceeds total memory size");
+                            logPid(processTable[newPid].pid, "Process rejected - exceeds the memory it can be placed in");
+                            summaryProcessRejected();
                             deleteProcess(&processTable[newPid]);
                         }
                     }
@@ -258,44 +629,114 @@ void coreLoop(void) {
             }
         }
 
+        // make the next arrival known before the next event is determined
+        checkForProcessInBatch();
         delta = runToNextEvent(&nextEvent, &eventPid);
+        delta = streamWait(delta, &nextEvent);    // wall-clock pacing and the live feed, if enabled
         if (delta > 0) {
             updateAllVirtualTimes(delta);
             systemTime += delta;
         }
+        statsPeriodicSnapshot();
 
         if (nextEvent == completed) {
             logPid(eventPid, "Process completed, freeing memory");
 
-            usedMemory -= processTable[eventPid].size;
-            freeMemory(processTable[eventPid].start, processTable[eventPid].size);
+            statsUsedMemoryChanging();
+            arenaProcessReleased(&processTable[eventPid]);
+            logProcessChange(memoryRemoved, processTable[eventPid].pid, processTable[eventPid].start,
+                processTable[eventPid].size, 0);
+            segmentProcessReleased(&processTable[eventPid]);    // reduces usedMemory
+            numaProcessReleased(&processTable[eventPid]);
+            ownerProcessReleased(&processTable[eventPid]);
+            summaryMemoryChanged();
+            summaryProcessCompleted(&processTable[eventPid]);
+            removeProcessFromCore(eventPid);
             deleteProcess(&processTable[eventPid]);
             runningCount--;
 
-            PCB_t* blockedProcess;
-            while ((blockedProcess = dequeueBlockedProcess()) != NULL) {
-                FreeBlock_t* block = findFreeBlock(blockedProcess->size);
-                if (block != NULL) {
-                    blockedProcess->start = block->start;
-                    blockedProcess->status = running;
-                    runningCount++;
-                    usedMemory += blockedProcess->size;
-                    logPid(blockedProcess->pid, "Blocked process started");
-                }
-                else {
-                    enqueueBlockedProcessWithPriority(blockedProcess);
-                    break;
-                }
-            }
+            startWaitingProcesses();
             logMemoryState();
         }
+        // segments of waiting processes must not keep them waiting forever
+        if (segmentDetachWaiting()) startWaitingProcesses();
+        checkpointPeriodic();
+        controlService();   // a command of the control socket, if any
+        if (shardService()) break;    // the window of a sharded run is done
 
     } while ((runningCount > 0) || (batchComplete == FALSE));
 
+    logQuickFitStatistics();
+    logCoreStatistics();
+    logNumaStatistics();
+    logArenaStatistics();
+    logAdmissionStatistics();
+    logSegmentStatistics();
+    logStreamStatistics();
+    dumpProbes();
     logGeneric("Batch processing complete, shutting down");
 }
+void saveCoreCheckpoint(Checkpoint_t* pCheckpoint) {
+    FreeBlock_t* block;
+    BlockedProcess_t* blocked;
+    unsigned n = 0;
+
+    pCheckpoint->core.pidCounter = pidCounter;
+    for (block = freeList; block != NULL; block = block->next) {
+        pCheckpoint->core.freeBlocks[n].start = block->start;
+        pCheckpoint->core.freeBlocks[n].size = block->size;
+        n++;
+    }
+    pCheckpoint->core.freeBlockCount = n;
+    n = 0;
+    for (blocked = blockedQueue; blocked != NULL; blocked = blocked->next) {
+        pCheckpoint->core.blocked[n++] = blocked->process->pid;
+    }
+    pCheckpoint->core.blockedCount = n;
+}
+
+void restoreCoreCheckpoint(const Checkpoint_t* pCheckpoint) {
+    FreeBlock_t** pNextBlock = &freeList;
+    BlockedProcess_t** pNextBlocked = &blockedQueue;
+    unsigned i;
+
+    while (freeList != NULL) {
+        FreeBlock_t* temp = freeList;
+        freeList = freeList->next;
+        free(temp);
+    }
+    while (blockedQueue != NULL) {
+        BlockedProcess_t* temp = blockedQueue;
+        blockedQueue = blockedQueue->next;
+        free(temp);
+    }
+    pidCounter = pCheckpoint->core.pidCounter;
+    for (i = 0; i < pCheckpoint->core.freeBlockCount; i++) {
+        FreeBlock_t* block = (FreeBlock_t*)malloc(sizeof(FreeBlock_t));
+        if (block == NULL) {
+            fprintf(stderr, "Memory allocation failed during restore.\n");
+            exit(1);
+        }
+        block->start = pCheckpoint->core.freeBlocks[i].start;
+        block->size = pCheckpoint->core.freeBlocks[i].size;
+        block->next = NULL;
+        *pNextBlock = block;
+        pNextBlock = &block->next;
+    }
+    for (i = 0; i < pCheckpoint->core.blockedCount; i++) {
+        BlockedProcess_t* blocked = (BlockedProcess_t*)malloc(sizeof(BlockedProcess_t));
+        if (blocked == NULL) {
+            fprintf(stderr, "Memory allocation failed during restore.\n");
+            exit(1);
+        }
+        blocked->process = &processTable[pCheckpoint->core.blocked[i]];
+        blocked->next = NULL;
+        *pNextBlocked = blocked;
+        pNextBlocked = &blocked->next;
+    }
+}
+
 unsigned getNextPid() {
-    static unsigned pidCounter = 0;
     unsigned i = 0;
 
     do {
@@ -308,6 +749,18 @@ unsigned getNextPid() {
     return pidCounter;
 }
 
+void setLastPid(unsigned pid) {
+    pidCounter = pid % MAX_PID;
+}
+
+Boolean isPidAvailable(void) {
+    unsigned i;
+
+    for (i = 1; i < MAX_PID; i++)
+        if (!processTable[i].valid) return TRUE;
+    return FALSE;
+}
+
 int initNewProcess(pid_t newPid, PCB_t* pProcess)
 {
     if (pProcess == NULL)
@@ -317,11 +770,16 @@ int initNewProcess(pid_t newPid, PCB_t* pProcess)
         processTable[newPid].ppid = pProcess->ppid;
         processTable[newPid].ownerID = pProcess->ownerID;
         processTable[newPid].start = pProcess->start;
+        processTable[newPid].arrival = pProcess->start;
         processTable[newPid].duration = pProcess->duration;
         processTable[newPid].size = pProcess->size;
         processTable[newPid].usedCPU = pProcess->usedCPU;
+        processTable[newPid].core = 0;
         processTable[newPid].type = pProcess->type;
         processTable[newPid].status = init;
+        processTable[newPid].imageSegment = 0;
+        processTable[newPid].parentSegment = 0;
+        processTable[newPid].sharedSize = 0;
         processTable[newPid].valid = TRUE;
         pProcess->valid = FALSE;
         return 1;
@@ -338,11 +796,16 @@ int deleteProcess(PCB_t* pProcess)
         pProcess->ppid = 0;
         pProcess->ownerID = 0;
         pProcess->start = 0;
+        pProcess->arrival = 0;
         pProcess->duration = 0;
         pProcess->size = 0;
         pProcess->usedCPU = 0;
+        pProcess->core = 0;
         pProcess->type = os;
         pProcess->status = ended;
+        pProcess->imageSegment = 0;
+        pProcess->parentSegment = 0;
+        pProcess->sharedSize = 0;
         return 1;
     }
 }
@@ -5,6 +5,20 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include "bs_types.h"
+
+/* data type for the placement policies of the free list */
+typedef enum
+	{
+		placementFirstFit,	// every request from the low end
+		placementTwoEnded	// small requests from the high end, large ones from the low end
+	} PlacementPolicy_t;
+
+// default size below which a request is small for two-ended placement
+#define PLACEMENT_DEFAULT_THRESHOLD 64
+
+extern PlacementPolicy_t placementPolicy;	// placementFirstFit by default
+extern unsigned smallThreshold;		// requests below this size are small
 
 
 void initOS(void);
@@ -21,6 +35,13 @@ unsigned getNextPid();
 /* returns 0 in case of an error like a fully occupied process-table*/
 /* +++ this must be replaced for multiprogramming					*/
 
+Boolean isPidAvailable(void);
+/* returns TRUE if getNextPid() can hand out a pid							*/
+
+void setLastPid(unsigned pid);
+/* getNextPid() continues after the given pid, for a run that starts in		*/
+/* the middle of a trace. Call after initOS()								*/
+
 int initNewProcess(pid_t newPid, PCB_t* pProcess);
 /* Initialised the PCB at the given index of the process table with the		*/
 /* process information provided in the PCB-struct giben by the pointer		*/
@@ -30,5 +51,76 @@ int deleteProcess(PCB_t* pProcess);
 /* flag to invalid and setting other values to invalid values.				*/
 /* retuns 0 on error and 1 on success										*/
 
+Boolean parsePlacementPolicy(const char* name);
+/* sets placementPolicy from its name "first-fit" or "two-ended"			*/
+/* returns FALSE for an unknown name										*/
+
+Boolean findFreeBlock(unsigned size, unsigned* pStart);
+/* first-fit search of the free list for a block of at least size units	*/
+/* the block is removed from the free list or shrunk by size units			*/
+/* With two-ended placement a small request takes the highest suitable		*/
+/* block and is served from its upper end, so long-lived small processes	*/
+/* collect at the top of the memory instead of splitting the large holes	*/
+/* on success the start address of the allocated range is stored in pStart	*/
+/* returns TRUE on success and FALSE if no suitable block exists			*/
+
+Boolean findFreeBlockOnNode(unsigned size, unsigned node, unsigned* pStart);
+/* like findFreeBlock(), restricted to the free blocks of one memory node	*/
+
+void freeMemory(unsigned start, unsigned size);
+/* returns the range given by start and size to the free list and merges	*/
+/* it with adjacent free blocks of the same memory node						*/
+
+Boolean allocateMemory(unsigned size, unsigned home, unsigned* pStart);
+/* allocates size units for a process with the given home node. The nodes	*/
+/* are tried in the order of the placement policy, each one served from		*/
+/* the quick-fit caches if possible, otherwise by findFreeBlockOnNode().	*/
+/* The caches are flushed as a last resort.									*/
+/* On success the start address is stored in pStart							*/
+/* returns TRUE on success and FALSE if no suitable block exists			*/
+
+Boolean tryAllocateMemory(unsigned size, unsigned home, unsigned* pStart);
+/* like allocateMemory(), but never flushes the quick-fit caches: for		*/
+/* callers that try several requests before they give up					*/
+
+void releaseMemory(unsigned start, unsigned size);
+/* releases the memory of a process, either into a quick-fit cache or by	*/
+/* freeMemory() into the free list											*/
+
+void enqueueBlockedProcessWithPriority(PCB_t* process);
+/* inserts the process into the blocked queue, ordered by ascending size	*/
+
+PCB_t* dequeueBlockedProcess(void);
+/* removes and returns the head of the blocked queue, NULL if it is empty	*/
+
+Boolean removeBlockedProcess(PCB_t* process);
+/* removes the given process from the blocked queue							*/
+/* returns FALSE if it is not in the queue									*/
+
+Boolean claimFreeRange(unsigned start, unsigned size);
+/* allocates exactly the given range, which must lie within one free block	*/
+/* the block is split if the range does not cover it completely				*/
+/* returns FALSE if the range is not free									*/
+
+void placeProcess(PCB_t* pProcess, unsigned start);
+/* makes a process that got the memory at start running: accounting of		*/
+/* memory, nodes and arena, and assignment to a core						*/
+
+struct Checkpoint;
+
+void resumeCoreLoop(void);
+/* the core scheduling loop without initialisation, continues the run from	*/
+/* the current state, e.g. after restoreCheckpoint()						*/
+
+void saveCoreCheckpoint(struct Checkpoint* pCheckpoint);
+/* stores the free list, the blocked queue and the pid counter				*/
+
+void restoreCoreCheckpoint(const struct Checkpoint* pCheckpoint);
+/* rebuilds the free list, the blocked queue and the pid counter			*/
+
+void compactMemoryWithSimulation(void);
+/* moves all running processes to the low end of their memory node so that	*/
+/* the free memory of every node forms a single block. With two-ended		*/
+/* placement small processes are moved to the high end instead				*/
 
 #endif /* __CORE__ */
\ No newline at end of file
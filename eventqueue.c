@@ -0,0 +1,197 @@
+/* Implementation of the event queue as hierarchical timing wheel */
+/* for comments on the functions see the associated .h-file */
+
+/* ---------------------------------------------------------------- */
+/* Include required external definitions */
+#include "globals.h"
+#include "eventqueue.h"
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#define OCCUPIED_WORDS (EVENT_WHEEL_SLOTS / 64)
+
+/* ----------------------------------------------------------------	*/
+/* Declarations of global variables visible only in this file 		*/
+
+// Invariant: an event on level n > 0 has the same time bits above group n
+// as wheelTime and a larger group n, an event on level 0 differs from
+// wheelTime in group 0 only (or is due at wheelTime). So level 0 holds the
+// next events, and the first occupied slot of a higher level is moved down
+// when the lower levels have run empty.
+static Event_t* wheel[EVENT_WHEEL_LEVELS][EVENT_WHEEL_SLOTS];
+static unsigned long long occupied[EVENT_WHEEL_LEVELS][OCCUPIED_WORDS];	// one bit per non-empty slot
+static unsigned wheelTime;			// no queued event is filed earlier than this
+static unsigned eventCount;			// number of queued events
+
+/* ---------------------------------------------------------------- */
+/*                Declarations of local helper functions            */
+static void insertIntoWheel(Event_t* pEvent);
+static void unlinkFromWheel(Event_t* pEvent);
+static unsigned firstOccupiedSlot(unsigned level, unsigned from);
+static Boolean isEarlier(Event_t* a, Event_t* b);
+
+/* ---------------------------------------------------------------- */
+/*                Externally available functions                    */
+/* ---------------------------------------------------------------- */
+
+void initEventQueue(unsigned now)
+{
+	memset(wheel, 0, sizeof(wheel));
+	memset(occupied, 0, sizeof(occupied));
+	wheelTime = now;
+	eventCount = 0;
+}
+
+void initEvent(Event_t* pEvent, SchedulingEvent_t type, pid_t pid)
+{
+	pEvent->time = 0;
+	pEvent->type = type;
+	pEvent->pid = pid;
+	pEvent->queued = FALSE;
+	pEvent->level = 0;
+	pEvent->slot = 0;
+	pEvent->next = NULL;
+	pEvent->prev = NULL;
+}
+
+void scheduleEvent(Event_t* pEvent, unsigned time)
+{
+	if (pEvent->queued)
+	{
+		if (pEvent->time == time) return;
+		unlinkFromWheel(pEvent);
+	}
+	pEvent->time = time;
+	insertIntoWheel(pEvent);
+}
+
+void cancelEvent(Event_t* pEvent)
+{
+	if (pEvent->queued) unlinkFromWheel(pEvent);
+}
+
+Event_t* peekNextEvent(void)
+{
+	Event_t* pEvent;
+	Event_t* pBest;
+	Event_t* pCascade;
+	unsigned level, slot, shift;
+
+	if (eventCount == 0) return NULL;
+	for (;;)
+	{
+		slot = firstOccupiedSlot(0, wheelTime & (EVENT_WHEEL_SLOTS - 1));
+		if (slot < EVENT_WHEEL_SLOTS)
+		{	// all events of the slot are due at the same time, except late ones
+			wheelTime = (wheelTime & ~(EVENT_WHEEL_SLOTS - 1)) | slot;
+			pBest = wheel[0][slot];
+			for (pEvent = pBest->next; pEvent != NULL; pEvent = pEvent->next)
+				if (isEarlier(pEvent, pBest)) pBest = pEvent;
+			return pBest;
+		}
+		// level 0 is empty: advance to the first occupied slot of the next
+		// non-empty level and spread its events over the lower levels
+		for (level = 1; level < EVENT_WHEEL_LEVELS; level++)
+		{
+			shift = level * EVENT_WHEEL_BITS;
+			slot = firstOccupiedSlot(level, ((wheelTime >> shift) & (EVENT_WHEEL_SLOTS - 1)) + 1);
+			if (slot < EVENT_WHEEL_SLOTS) break;
+		}
+		if (level == EVENT_WHEEL_LEVELS) return NULL;	// not reached while eventCount > 0
+		if (shift + EVENT_WHEEL_BITS < 32)
+			wheelTime = (wheelTime >> (shift + EVENT_WHEEL_BITS)) << (shift + EVENT_WHEEL_BITS);
+		else wheelTime = 0;
+		wheelTime |= slot << shift;
+		pCascade = wheel[level][slot];
+		wheel[level][slot] = NULL;
+		occupied[level][slot / 64] &= ~(1ULL << (slot % 64));
+		while (pCascade != NULL)
+		{
+			pEvent = pCascade;
+			pCascade = pCascade->next;
+			eventCount--;
+			insertIntoWheel(pEvent);
+		}
+	}
+}
+
+unsigned queuedEventCount(void)
+{
+	return eventCount;
+}
+
+/* ----------------------------------------------------------------- */
+/*                       Local helper functions                      */
+/* ----------------------------------------------------------------- */
+
+static void insertIntoWheel(Event_t* pEvent)
+{	// files the event by the highest bit group in which it differs from wheelTime
+	unsigned key = (pEvent->time > wheelTime) ? pEvent->time : wheelTime;
+	unsigned diff = key ^ wheelTime;
+	unsigned level;
+
+	for (level = EVENT_WHEEL_LEVELS - 1; (level > 0) && ((diff >> (level * EVENT_WHEEL_BITS)) == 0); level--);
+	pEvent->level = level;
+	pEvent->slot = (key >> (level * EVENT_WHEEL_BITS)) & (EVENT_WHEEL_SLOTS - 1);
+	pEvent->prev = NULL;
+	pEvent->next = wheel[level][pEvent->slot];
+	if (pEvent->next != NULL) pEvent->next->prev = pEvent;
+	wheel[level][pEvent->slot] = pEvent;
+	occupied[level][pEvent->slot / 64] |= 1ULL << (pEvent->slot % 64);
+	pEvent->queued = TRUE;
+	eventCount++;
+}
+
+static void unlinkFromWheel(Event_t* pEvent)
+{
+	if (pEvent->prev != NULL) pEvent->prev->next = pEvent->next;
+	else wheel[pEvent->level][pEvent->slot] = pEvent->next;
+	if (pEvent->next != NULL) pEvent->next->prev = pEvent->prev;
+	if (wheel[pEvent->level][pEvent->slot] == NULL)
+		occupied[pEvent->level][pEvent->slot / 64] &= ~(1ULL << (pEvent->slot % 64));
+	pEvent->next = NULL;
+	pEvent->prev = NULL;
+	pEvent->queued = FALSE;
+	eventCount--;
+}
+
+static unsigned firstOccupiedSlot(unsigned level, unsigned from)
+{	// returns EVENT_WHEEL_SLOTS if no slot from the given one on is occupied
+	unsigned long long bits;
+	unsigned word;
+
+	for (word = from / 64; word < OCCUPIED_WORDS; word++)
+	{
+		bits = occupied[level][word];
+		if (word == from / 64) bits &= ~0ULL << (from % 64);
+		if (bits == 0) continue;
+#if defined(__GNUC__) || defined(__clang__)
+		return word * 64 + (unsigned)__builtin_ctzll(bits);
+#elif defined(_MSC_VER) && defined(_WIN64)
+		{
+			unsigned long index;
+			_BitScanForward64(&index, bits);
+			return word * 64 + index;
+		}
+#else
+		{
+			unsigned index = 0;
+			while ((bits & 1) == 0)
+			{
+				bits >>= 1;
+				index++;
+			}
+			return word * 64 + index;
+		}
+#endif
+	}
+	return EVENT_WHEEL_SLOTS;
+}
+
+static Boolean isEarlier(Event_t* a, Event_t* b)
+{	// order of events due at the same time: by type, then by pid
+	if (a->time != b->time) return a->time < b->time;
+	if (a->type != b->type) return a->type < b->type;
+	return a->pid < b->pid;
+}
@@ -0,0 +1,54 @@
+/* Include-file defining the event queue of the simulation					*/
+/* The pending scheduling events (process arrivals, completions, IO			*/
+/* completions and quantum expiries) are kept in a hierarchical timing		*/
+/* wheel: EVENT_WHEEL_LEVELS levels of EVENT_WHEEL_SLOTS slots, level n		*/
+/* sorting by the n-th group of EVENT_WHEEL_BITS bits of the event time.	*/
+/* Inserting and cancelling an event is O(1), finding the next event is		*/
+/* O(1) amortized: every event is moved down at most once per level.		*/
+/* The events are embedded in the structures of their owners, the queue		*/
+/* never allocates memory. An event stays queued until its owner cancels	*/
+/* or reschedules it.														*/
+#ifndef __EVENTQUEUE__
+#define __EVENTQUEUE__
+
+#include "bs_types.h"
+
+#define EVENT_WHEEL_BITS	8
+#define EVENT_WHEEL_SLOTS	(1U << EVENT_WHEEL_BITS)
+#define EVENT_WHEEL_LEVELS	4		// covers the whole range of unsigned time
+
+/* data type for one pending event */
+typedef struct Event {
+	unsigned time;				// simulated time the event is due
+	SchedulingEvent_t type;		// on equal time: completed, io, quantumOver, start
+	pid_t pid;					// process concerned, on equal time and type the lower first
+	Boolean queued;				// the event is in the wheel
+	unsigned level, slot;		// position in the wheel while queued
+	struct Event* next;
+	struct Event* prev;
+} Event_t;
+
+
+void initEventQueue(unsigned now);
+/* empties the wheel and sets its current time; all events still marked	*/
+/* as queued by their owners must be initialised again by initEvent()		*/
+
+void initEvent(Event_t* pEvent, SchedulingEvent_t type, pid_t pid);
+/* initialises an event that is not queued									*/
+
+void scheduleEvent(Event_t* pEvent, unsigned time);
+/* queues the event for the given time, an already queued event is moved	*/
+/* time may lie in the past, the event is then due immediately				*/
+
+void cancelEvent(Event_t* pEvent);
+/* removes the event from the wheel, nothing happens if it is not queued	*/
+
+Event_t* peekNextEvent(void);
+/* returns the next due event without removing it, NULL if none is queued	*/
+/* advances the current time of the wheel up to the time of that event,		*/
+/* events scheduled for an earlier time afterwards are due immediately		*/
+
+unsigned queuedEventCount(void);
+/* returns the number of queued events										*/
+
+#endif /* __EVENTQUEUE__ */
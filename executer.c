@@ -6,6 +6,7 @@
 /* Include required external definitions */
 #include <math.h>
 #include <time.h>
+#include <limits.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
@@ -13,16 +14,59 @@
 #include "globals.h"
 #include "core.h"
 #include "loader.h"
+#include "probe.h"
 #include "executer.h"
+#include "eventqueue.h"
+#include "checkpoint.h"
 
 
 
+// Virtual time is kept in fixed point with VTIME_FRACTION_BITS fractional
+// bits. Every core has a processor sharing clock that advances by 1/n per
+// time unit with n processes in its run queue. A process gets a finish tag
+// (clock at insertion + remaining time) and terminates when the clock of
+// its core reaches the tag, so advancing the time only touches the clocks.
+#define VTIME_FRACTION_BITS	32
+#define VTIME_ONE			(1ULL << VTIME_FRACTION_BITS)
+// rounding errors of the clocks below this are ignored, so a completion
+// rescheduled after the clock was rounded down does not slip by a time unit
+#define VTIME_SLACK			(1ULL << 16)
+
+typedef unsigned long long VirtualTime_t;
+
 /* ----------------------------------------------------------------	*/
 /* Declarations of global variables visible only in this file 		*/
+unsigned coreCount = 1;			// number of simulated CPU cores
+
+// per-core run queues, doubly linked through the pids, 0 terminates
+static pid_t runQueueHead[MAX_CORES];
+static unsigned runQueueLength[MAX_CORES];
+static pid_t runQueueNext[MAX_PROCESSES];
+static pid_t runQueuePrev[MAX_PROCESSES];
+static unsigned long long coreBusyTime[MAX_CORES];	// time with a non-empty run queue
+static unsigned coreCompleted[MAX_CORES];	// processes that left the core
+static unsigned migrationCount;			// processes moved by work stealing
+
+// The process of a core with the lowest finish tag terminates first. It only
+// changes when the run queue changes, its completion is kept as event of the
+// core and is only rescheduled when the run queue changed (core is dirty).
+static pid_t coreNextPid[MAX_CORES];	// process of the core to terminate next, 0 if idle
+static Boolean coreDirty[MAX_CORES];	// completion event must be rescheduled
+static VirtualTime_t coreClock[MAX_CORES];	// processor sharing clock of the core
+static VirtualTime_t finishTag[MAX_PROCESSES];	// clock value at which the process terminates
+static Event_t completionEvent[MAX_CORES];
+static Event_t arrivalEvent;			// start of the waiting candidate
+static unsigned int eventBaseTime;		// systemTime the completion events assume
+static Boolean cpuIdle = FALSE;			// idle time was logged, until a process runs again
 
 /* ---------------------------------------------------------------- */
 /*                Declarations of local functions					*/
-
+static void enqueueOnCore(pid_t pid, unsigned int core, VirtualTime_t remaining);
+static void unlinkFromCore(pid_t pid);
+static Boolean terminatesEarlier(pid_t pid, pid_t other);
+static void findCoreNextPid(unsigned int core);
+static void scheduleCoreCompletion(unsigned int core);
+static VirtualTime_t remainingTime(pid_t pid);
 
 
 /* ---------------------------------------------------------------- */
@@ -43,76 +87,273 @@ void flagNewProcessStarted(void) {
 
 unsigned int runToNextEvent(SchedulingEvent_t* nextEvent, pid_t* eventPid) {
 	// advances the system time until the next scheduling event occurs
-	unsigned int remaining;					// time to termination of a precess 
-	unsigned int minRemaining = UINT_MAX;	// time until the next process terminates
-	unsigned int delta= UINT_MAX;			// time interval by which the system time needs to be advanced
-	pid_t pid = 1;							// start search with lowest valid pid
-	unsigned int i = 0;						// counter for running processes 
-	unsigned int nextReadyPID = 0;			// pid of found process to terminate next 
+	unsigned int delta;						// time interval by which the system time needs to be advanced
+	unsigned int core;						// core inspected
+	unsigned int arrival;					// time the waiting candidate is due
+	Event_t* pEvent;						// next event of the queue
+	PROBE_BEGIN(probeRunToNextEvent);
 
 	*nextEvent = none;						// make sure a defined return happens
 	*eventPid = 0; 
-	while ((i<runningCount) && (pid<MAX_PROCESSES))
-	{	// search entire process table or until all current provcesses are checked
-		if ((processTable[pid].valid == TRUE) && (processTable[pid].status == running))
-		{
-			remaining = processTable[pid].duration - processTable[pid].usedCPU;
-			if (remaining<minRemaining)
-			{	// found a process finishing earlier than last match
-				nextReadyPID = pid;			// remember that process
-				minRemaining = remaining;	// update minimum
-				delta = minRemaining * runningCount;		// all processes advance until first to quit is finished
-				*nextEvent = completed;
-				*eventPid = nextReadyPID;
-			}
-			i++;	// one more running process used
-		}
-		pid++;		// next process entry
+	for (core = 0; core < coreCount; core++)
+	{	// only cores whose run queue or share changed need a new completion time,
+		// unless time passed without execution (e.g. loading of a process)
+		if (coreDirty[core] || (systemTime != eventBaseTime)) scheduleCoreCompletion(core);
 	}
-	// the next process to end is found. 
-	// unless a new process is started before that, so check for it: 
-	// check if the waiting candidate (if any) will start earlier
-	if (candidateProcess.valid)
+	eventBaseTime = systemTime;
+	// a candidate whose start time has already passed is due immediately,
+	// unless it has to wait for a free pid
+	if (candidateProcess.valid
+		&& ((candidateProcess.start > systemTime) || isPidAvailable()))
 	{
-		if ((candidateProcess.start >= systemTime)
-			&& (candidateProcess.start - systemTime < delta))
-		{	// the waiting process can start before any running one is complete
-			delta = (candidateProcess.start - systemTime);
-			nextReadyPID = 0;		// no process to terminate now
-			*nextEvent = start;		// but there is a candidate to start
-			*eventPid = 0;			// the candidate does not have a pid yet
-		}
+		arrival = (candidateProcess.start > systemTime) ? candidateProcess.start : systemTime;
+		scheduleEvent(&arrivalEvent, arrival);
 	}
+	else cancelEvent(&arrivalEvent);
+
 	if (runningCount == 0)
-	{	// notify the user in case of idle time 
+	{	// notify the user in case of idle time, once when it starts: a live
+		// feed polls here again and again until the next record arrives
 		//systemTime = candidateProcess.start;			// BUG korrigiert: Diese Funktion berechnet nur die Zeitspanne, die Aktualisierung der Systemzeit erfolgt in der Core-loop
-		logGeneric("Sim: CPU is turning idle now.");	// BUG korrigiert: Log-Ausgabe auch angepasst, das neue Systemzeit hier nicht bekannt.
+		if (!cpuIdle) logGeneric("Sim: CPU is turning idle now.");	// BUG korrigiert: Log-Ausgabe auch angepasst, das neue Systemzeit hier nicht bekannt.
+		cpuIdle = TRUE;
 	}
+	else cpuIdle = FALSE;
 
-	return max(1U, delta);			// make sure time advances, avoid zero delta due to integer arithmetics
+	// on equal time completions come first (lower pid first), then the candidate
+	pEvent = peekNextEvent();
+	if (pEvent == NULL)
+	{	// nothing left to wait for
+		PROBE_END(probeRunToNextEvent);
+		return 0;
+	}
+	*nextEvent = pEvent->type;
+	*eventPid = pEvent->pid;		// the candidate does not have a pid yet
+	// events due at once are returned one after the other with zero delta
+	delta = (pEvent->time > systemTime) ? (pEvent->time - systemTime) : 0;
+	eventBaseTime = systemTime + delta;	// the caller executes delta, then advances the time
+	PROBE_END(probeRunToNextEvent);
+	return delta;
 }
 
 void updateAllVirtualTimes(unsigned int delta)
 {
 	// update all processes according to elapsed time
 	// the parameter specifies the elapsed physical time, so each running process is 
-	// executed by its equal share. 
-	unsigned int pid = 1;			// start search with lowest valid pid and 
-	unsigned int i = 0;				// init counter for running processes 
+	// executed by its equal share of the core it is assigned to. 
+	// Only the clocks of the cores advance, usedCPU of a process is derived
+	// from its finish tag when it leaves the core.
+	unsigned int core;
+	PROBE_BEGIN(probeUpdateVirtualTimes);
 	
-	while ((i < runningCount) && (pid < MAX_PROCESSES))
-	{	// search entire process table or until all current provcesses are checked
-		if ((processTable[pid].valid == TRUE) && (processTable[pid].status == running))
-		{
-			// update time already spent in process
-			processTable[pid].usedCPU = processTable[pid].usedCPU + delta / runningCount;
-			i++;	// one more running process updated
-		}
-		pid++;		// next process entry
+	for (core = 0; core < coreCount; core++)
+	{
+		if (runQueueLength[core] == 0) continue;
+		coreBusyTime[core] += delta;
+		coreClock[core] += ((VirtualTime_t)delta << VTIME_FRACTION_BITS) / runQueueLength[core];
+	}
+	PROBE_END(probeUpdateVirtualTimes);
+}
+
+void initCores(void)
+{
+	unsigned int core;
+
+	for (core = 0; core < MAX_CORES; core++)
+	{
+		runQueueHead[core] = 0;
+		runQueueLength[core] = 0;
+		coreBusyTime[core] = 0;
+		coreCompleted[core] = 0;
+		coreNextPid[core] = 0;
+		coreDirty[core] = FALSE;
+		coreClock[core] = 0;
+		initEvent(&completionEvent[core], completed, 0);
+	}
+	migrationCount = 0;
+	initEventQueue(systemTime);
+	eventBaseTime = systemTime;
+	initEvent(&arrivalEvent, start, 0);
+	cpuIdle = FALSE;
+}
+
+void assignProcessToCore(pid_t pid)
+{
+	unsigned int core, target = 0;
+
+	for (core = 1; core < coreCount; core++)
+	{	// the least loaded core, the lowest on ties
+		if (runQueueLength[core] < runQueueLength[target]) target = core;
+	}
+	enqueueOnCore(pid, target,
+		(VirtualTime_t)(processTable[pid].duration - processTable[pid].usedCPU) << VTIME_FRACTION_BITS);
+}
+
+void removeProcessFromCore(pid_t pid)
+{
+	unsigned int core = processTable[pid].core;
+	unsigned int core2, victim = core;
+	pid_t stolen;
+	VirtualTime_t remaining;
+
+	unlinkFromCore(pid);
+	coreCompleted[core]++;
+	// work stealing: the core that lost a process takes one from the most
+	// loaded core, if that has at least two processes more
+	for (core2 = 0; core2 < coreCount; core2++)
+	{
+		if (runQueueLength[core2] > runQueueLength[victim]) victim = core2;
+	}
+	if (runQueueLength[victim] >= runQueueLength[core] + 2)
+	{
+		stolen = runQueueHead[victim];
+		remaining = remainingTime(stolen);
+		unlinkFromCore(stolen);
+		enqueueOnCore(stolen, core, remaining);
+		migrationCount++;
 	}
 }
+
+void saveExecCheckpoint(Checkpoint_t* pCheckpoint)
+{
+	unsigned int core;
+
+	memcpy(pCheckpoint->exec.runQueueHead, runQueueHead, sizeof(runQueueHead));
+	memcpy(pCheckpoint->exec.runQueueLength, runQueueLength, sizeof(runQueueLength));
+	memcpy(pCheckpoint->exec.runQueueNext, runQueueNext, sizeof(runQueueNext));
+	memcpy(pCheckpoint->exec.runQueuePrev, runQueuePrev, sizeof(runQueuePrev));
+	memcpy(pCheckpoint->exec.coreBusyTime, coreBusyTime, sizeof(coreBusyTime));
+	memcpy(pCheckpoint->exec.coreCompleted, coreCompleted, sizeof(coreCompleted));
+	pCheckpoint->exec.migrationCount = migrationCount;
+	memcpy(pCheckpoint->exec.coreNextPid, coreNextPid, sizeof(coreNextPid));
+	memcpy(pCheckpoint->exec.coreDirty, coreDirty, sizeof(coreDirty));
+	memcpy(pCheckpoint->exec.coreClock, coreClock, sizeof(coreClock));
+	memcpy(pCheckpoint->exec.finishTag, finishTag, sizeof(finishTag));
+	pCheckpoint->exec.eventBaseTime = eventBaseTime;
+	for (core = 0; core < MAX_CORES; core++)
+	{
+		pCheckpoint->exec.completionQueued[core] = completionEvent[core].queued;
+		pCheckpoint->exec.completionTime[core] = completionEvent[core].time;
+		pCheckpoint->exec.completionPid[core] = completionEvent[core].pid;
+	}
+	pCheckpoint->exec.arrivalQueued = arrivalEvent.queued;
+	pCheckpoint->exec.arrivalTime = arrivalEvent.time;
+}
+
+void restoreExecCheckpoint(const Checkpoint_t* pCheckpoint)
+{
+	unsigned int core;
+
+	initCores();
+	memcpy(runQueueHead, pCheckpoint->exec.runQueueHead, sizeof(runQueueHead));
+	memcpy(runQueueLength, pCheckpoint->exec.runQueueLength, sizeof(runQueueLength));
+	memcpy(runQueueNext, pCheckpoint->exec.runQueueNext, sizeof(runQueueNext));
+	memcpy(runQueuePrev, pCheckpoint->exec.runQueuePrev, sizeof(runQueuePrev));
+	memcpy(coreBusyTime, pCheckpoint->exec.coreBusyTime, sizeof(coreBusyTime));
+	memcpy(coreCompleted, pCheckpoint->exec.coreCompleted, sizeof(coreCompleted));
+	migrationCount = pCheckpoint->exec.migrationCount;
+	memcpy(coreNextPid, pCheckpoint->exec.coreNextPid, sizeof(coreNextPid));
+	memcpy(coreDirty, pCheckpoint->exec.coreDirty, sizeof(coreDirty));
+	memcpy(coreClock, pCheckpoint->exec.coreClock, sizeof(coreClock));
+	memcpy(finishTag, pCheckpoint->exec.finishTag, sizeof(finishTag));
+	eventBaseTime = pCheckpoint->exec.eventBaseTime;
+	// the events are rescheduled at their original time, the wheel itself is not saved
+	for (core = 0; core < MAX_CORES; core++)
+	{
+		completionEvent[core].pid = pCheckpoint->exec.completionPid[core];
+		if (pCheckpoint->exec.completionQueued[core])
+			scheduleEvent(&completionEvent[core], pCheckpoint->exec.completionTime[core]);
+	}
+	if (pCheckpoint->exec.arrivalQueued)
+		scheduleEvent(&arrivalEvent, pCheckpoint->exec.arrivalTime);
+}
+
+void logCoreStatistics(void)
+{
+	char buffer[128];
+	unsigned int core;
+
+	if (coreCount < 2) return;
+	for (core = 0; core < coreCount; core++)
+	{
+		sprintf(buffer, "Core %2u: utilization %5.1f%%, %u processes completed",
+			core, (systemTime > 0) ? 100.0 * (double)coreBusyTime[core] / (double)systemTime : 0.0,
+			coreCompleted[core]);
+		logGeneric(buffer);
+	}
+	sprintf(buffer, "Cores: %u processes migrated by work stealing", migrationCount);
+	logGeneric(buffer);
+}
 /* ---------------------------------------------------------------- */
 /*                       Local functions							*/
 /* ---------------------------------------------------------------- */
 
+static void enqueueOnCore(pid_t pid, unsigned int core, VirtualTime_t remaining)
+{	// inserts the process at the head of the run queue of the core
+	processTable[pid].core = core;
+	finishTag[pid] = coreClock[core] + remaining;
+	runQueuePrev[pid] = 0;
+	runQueueNext[pid] = runQueueHead[core];
+	if (runQueueHead[core] != 0) runQueuePrev[runQueueHead[core]] = pid;
+	runQueueHead[core] = pid;
+	runQueueLength[core]++;
+	if ((coreNextPid[core] == 0) || terminatesEarlier(pid, coreNextPid[core])) coreNextPid[core] = pid;
+	coreDirty[core] = TRUE;
+}
+
+static void unlinkFromCore(pid_t pid)
+{
+	unsigned int core = processTable[pid].core;
 
+	processTable[pid].usedCPU = processTable[pid].duration
+		- (unsigned int)((remainingTime(pid) + VTIME_ONE - VTIME_SLACK) >> VTIME_FRACTION_BITS);
+	if (runQueuePrev[pid] != 0) runQueueNext[runQueuePrev[pid]] = runQueueNext[pid];
+	else runQueueHead[core] = runQueueNext[pid];
+	if (runQueueNext[pid] != 0) runQueuePrev[runQueueNext[pid]] = runQueuePrev[pid];
+	runQueueLength[core]--;
+	if (coreNextPid[core] == pid) findCoreNextPid(core);
+	coreDirty[core] = TRUE;
+}
+
+static Boolean terminatesEarlier(pid_t pid, pid_t other)
+{	// lower finish tag on the same core, on ties the lower pid
+	return (finishTag[pid] < finishTag[other])
+		|| ((finishTag[pid] == finishTag[other]) && (pid < other));
+}
+
+static void findCoreNextPid(unsigned int core)
+{
+	pid_t pid;
+
+	coreNextPid[core] = runQueueHead[core];
+	for (pid = runQueueHead[core]; pid != 0; pid = runQueueNext[pid])
+		if (terminatesEarlier(pid, coreNextPid[core])) coreNextPid[core] = pid;
+}
+
+static void scheduleCoreCompletion(unsigned int core)
+{	// all processes of the core advance until the first one quits
+	pid_t pid = coreNextPid[core];
+	VirtualTime_t remaining;
+	unsigned int delay;
+
+	coreDirty[core] = FALSE;
+	if (pid == 0)
+	{
+		cancelEvent(&completionEvent[core]);
+		return;
+	}
+	completionEvent[core].pid = pid;
+	// remaining * n, rounded up, split into integer and fraction to avoid an overflow
+	remaining = remainingTime(pid);
+	delay = (unsigned int)(remaining >> VTIME_FRACTION_BITS) * runQueueLength[core]
+		+ (unsigned int)(((remaining & (VTIME_ONE - 1)) * runQueueLength[core] + VTIME_ONE - VTIME_SLACK)
+			>> VTIME_FRACTION_BITS);
+	scheduleEvent(&completionEvent[core], systemTime + delay);
+}
+
+static VirtualTime_t remainingTime(pid_t pid)
+{	// remaining execution time of a process on its core
+	VirtualTime_t clock = coreClock[processTable[pid].core];
+
+	return (finishTag[pid] > clock) ? finishTag[pid] - clock : 0;
+}
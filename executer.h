@@ -24,12 +24,41 @@ unsigned int runToNextEvent(SchedulingEvent_t* nextEvent, pid_t* eventPid);
 // advance the system time until the next scheduling event occurs
 // the event and the pid of the process causing it are updated in the passed parameters
 // the time interval to pass until this event occurs is given by the return value
+// it is zero if the event is due now, e.g. for several processes completing at once
 
 
 void updateAllVirtualTimes(unsigned int delta); 
 // update the virtual time of all currently running processes
 // the paratmeter specifies the elapdes physical time, i.e. each process
-// is executes by only its part (assumed to be equal shares)
-// zero updates may occure due to integer arithmetics
+// is executes by only its part (assumed to be equal shares of the core it
+// is assigned to)
+// the shares are kept in fixed point, so no time is lost by integer division
+
+
+extern unsigned coreCount;	// number of simulated CPU cores, 1 by default
+
+void initCores(void);
+// empties the run queues of all cores and resets their statistics
+
+void assignProcessToCore(pid_t pid);
+// puts a process that starts running into the run queue of the least
+// loaded core
+
+void removeProcessFromCore(pid_t pid);
+// takes a process that stops running out of its run queue. The core then
+// steals a process from the most loaded core if that one has at least two
+// processes more (work stealing)
+
+struct Checkpoint;
+
+void saveExecCheckpoint(struct Checkpoint* pCheckpoint);
+// stores the run queues, the clocks of the cores and the pending events
+
+void restoreExecCheckpoint(const struct Checkpoint* pCheckpoint);
+// restores the run queues and clocks and reschedules the pending events
+
+void logCoreStatistics(void);
+// prints the utilization and completed processes of each core and the
+// number of migrations, only if more than one core is simulated
 
 #endif /* __EXEC__ */
\ No newline at end of file
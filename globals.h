@@ -19,6 +19,12 @@
 // Largest valid pid
 #define MAX_PID 100
 
+// Largest number of simulated CPU cores
+#define MAX_CORES 64
+
+// Largest number of memory nodes (banks)
+#define MAX_NODES 8
+
 // Maximum duration one process gets the CPU, zero indicates no preemption
 #define QUANTUM 0
 
@@ -54,5 +60,11 @@ extern FreeBlock_t* freeList;
 extern BlockedProcess_t* blockedQueue;
 
 extern PCB_t candidateProcess;	// only for simulation purposes
+extern unsigned simSeed;		// seed of the random number generator of this run, reserved:
+								// nothing draws random numbers yet, see dispatcher.c
+
+/* ----------------------------------------------------------------	*/
+/* Functions available in all sourcefiles, defined in log.c			*/
+double nowNs(void);				// monotonic wall-clock time stamp in nanoseconds
 
 #endif  /* __GLOBALS__ */ 
\ No newline at end of file
@@ -11,14 +11,48 @@
 #include "bs_types.h"
 #include "globals.h"
 #include "log.h"
+#include "stream.h"
+
+#ifndef _WIN32			// the loader thread needs POSIX threads, Windows reads inline
+#define LOADER_THREADS
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#endif
+
+/* data type of a record passed from the loader thread to the core loop */
+typedef struct
+	{
+		PCB_t process;			// components read from the trace
+		long long nextOffset;	// trace position after this record
+		Boolean valid;			// FALSE marks the end of the trace
+	} LoaderRecord_t;
 
 /* ----------------------------------------------------------------	*/
 /* Declarations of global variables visible only in this file 		*/
 extern PCB_t candidateProcess;		// only for simulation purposes
+Boolean loaderThreadEnabled = FALSE;
+
+static long long consumedOffset = 0;	// trace position after the last fetched record
+static Boolean feedWaiting = FALSE;		// a live feed had no record at the last attempt
+#ifdef LOADER_THREADS
+// single producer/single consumer ring, the producer only writes ringHead and
+// the slots in front of it, the consumer only writes ringTail
+static LoaderRecord_t ring[LOADER_RING_SIZE];
+static atomic_uint ringHead;		// records written so far
+static atomic_uint ringTail;		// records read so far
+static atomic_int stopRequested;
+static pthread_t loaderThread;
+static Boolean traceClosed;			// the thread closed the trace at its end
+#endif
+static Boolean loaderRunning = FALSE;
 
 /* ---------------------------------------------------------------- */
 /*                Declarations of local helper functions            */
-// none
+static Boolean fetchNextProcess(PCB_t* pProcess);
+#ifdef LOADER_THREADS
+static void* produceRecords(void* argument);
+#endif
 
 /* ---------------------------------------------------------------- */
 /*                Externally available functions                    */
@@ -33,8 +67,8 @@ FILE* openConfigFile (FILE *file, const char * filename)
 	char ownerIDStr[21]="", startStr[21]=""; // buffers for reading process type-string
 	char durationStr[21]="", processTypeStr [21]=""; 	// buffers for reading process type-string
 
-	// try to open file for read
-	file = fopen (filename, "r");
+	// try to open file for read, "-" is the standard input
+	file = (strcmp(filename, "-") == 0) ? stdin : fopen (filename, "r");
 	// test for success and error handling
 	if (file == NULL)
 		{
@@ -52,8 +86,6 @@ FILE* openConfigFile (FILE *file, const char * filename)
 Boolean readNextProcess (FILE* f, PCB_t* pProcess)
 {
 	char linebuffer[129]="";		// read buffer for file-input
-	char processTypeStr [21]=""; 	// buffers for reading process type-string
-	int readOK; 
 	if (f==NULL) return FALSE;		// error: file handle not initialised
 	if (feof(f))
 		{
@@ -66,22 +98,7 @@ Boolean readNextProcess (FILE* f, PCB_t* pProcess)
 		if (strcmp(linebuffer, "")==0)
 			return FALSE;			// error occured: line is empty
 		else
-		{
-			readOK=sscanf (linebuffer, "%u %u %u %u %s", &pProcess->ownerID, &pProcess->start, 
-				&pProcess->duration, &pProcess->size, processTypeStr);
-
-			if (strcmp(processTypeStr, "os")==0)
-				pProcess->type=os;
-			else if (strcmp(processTypeStr, "interactive")==0)
-				pProcess->type=interactive;
-			else if (strcmp(processTypeStr, "batch")==0)
-				pProcess->type=batch;
-			else if (strcmp(processTypeStr, "background")==0)
-				pProcess->type=background;
-			else if (strcmp(processTypeStr, "foreground")==0)
-				pProcess->type=foreground;
-			else pProcess->type=os;
-		}
+			parseProcessRecord(linebuffer, pProcess);
 		// Debug-output to show the data read in the line of the processes.txt-file
 		//printf( "Sim: New process read from File: %u %u %u %u %s\n", pProcess->ownerID, pProcess->start, pProcess->duration, pProcess->size, processTypeStr);
 
@@ -89,18 +106,42 @@ Boolean readNextProcess (FILE* f, PCB_t* pProcess)
 	return TRUE; 
 }
 
+void parseProcessRecord(const char* line, PCB_t* pProcess)
+{
+	char processTypeStr [21]=""; 	// buffers for reading process type-string
+
+	sscanf (line, "%u %u %u %u %20s", &pProcess->ownerID, &pProcess->start, 
+		&pProcess->duration, &pProcess->size, processTypeStr);
+
+	if (strcmp(processTypeStr, "os")==0)
+		pProcess->type=os;
+	else if (strcmp(processTypeStr, "interactive")==0)
+		pProcess->type=interactive;
+	else if (strcmp(processTypeStr, "batch")==0)
+		pProcess->type=batch;
+	else if (strcmp(processTypeStr, "background")==0)
+		pProcess->type=background;
+	else if (strcmp(processTypeStr, "foreground")==0)
+		pProcess->type=foreground;
+	else pProcess->type=os;
+}
+
 Boolean checkForProcessInBatch() {
 	// select and run a process
-	if (!candidateProcess.valid)	// no candidate read from file yet
-	{
-		logGeneric("Sim: Reading next process from file");
+	if (!candidateProcess.valid && !batchComplete)	// no candidate read from file yet
+	{	// the file is closed once EOF was reached, so never read past it
+		// a waiting feed is polled again and again, logged once per record
+		if (!feedWaiting) logGeneric("Sim: Reading next process from file");
 		// read the next process for the file and store in process table
-		candidateProcess.valid = readNextProcess(processFile, &candidateProcess);
+		candidateProcess.valid = fetchNextProcess(&candidateProcess);
+		feedWaiting = FALSE;
 		if (candidateProcess.valid)
 		{	// there are still jobs listed in the file   
 			logGeneric("Sim: Next process loaded from file");
 			logLoadedProcessData(&candidateProcess);
 		}
+		else if (followInput && !streamFinished())
+			feedWaiting = TRUE;	// no record yet, the feed goes on
 		else	// no more processes to be started 
 		{
 			logGeneric("Sim: No further process listed for execution.");
@@ -115,3 +156,110 @@ PCB_t* getNewPCBptr(void)
 {
 	return &candidateProcess;
 }
+
+Boolean startLoaderThread(void)
+{
+#ifdef LOADER_THREADS
+	if (!loaderThreadEnabled || loaderRunning || batchComplete || followInput) return FALSE;
+	consumedOffset = ftell(processFile);
+	atomic_store(&ringHead, 0);
+	atomic_store(&ringTail, 0);
+	atomic_store(&stopRequested, 0);
+	traceClosed = FALSE;
+	if (pthread_create(&loaderThread, NULL, produceRecords, processFile) != 0)
+	{
+		logGeneric("Sim: Loader thread cannot be started, reading inline");
+		return FALSE;
+	}
+	loaderRunning = TRUE;
+	logGeneric("Sim: Loader thread started");
+	return TRUE;
+#else
+	return FALSE;
+#endif
+}
+
+void stopLoaderThread(void)
+{
+#ifdef LOADER_THREADS
+	if (!loaderRunning) return;
+	atomic_store(&stopRequested, 1);	// releases a producer waiting for space
+	pthread_join(loaderThread, NULL);
+	loaderRunning = FALSE;
+	// the trace is handed back, at the first record not consumed if still open
+	if (traceClosed) processFile = NULL;
+	else if (processFile != NULL) fseek(processFile, (long)consumedOffset, SEEK_SET);
+#endif
+}
+
+long long loaderOffset(void)
+{
+	if (loaderRunning) return consumedOffset;
+	return (processFile != NULL) ? (long long)ftell(processFile) : 0;
+}
+
+/* ----------------------------------------------------------------- */
+/*                       Local helper functions                      */
+/* ----------------------------------------------------------------- */
+
+static Boolean fetchNextProcess(PCB_t* pProcess)
+{	// the next record of the trace, from the loader thread if it runs
+#ifdef LOADER_THREADS
+	LoaderRecord_t* pRecord;
+	unsigned tail;
+#endif
+
+	if (followInput) return streamReadProcess(pProcess);
+#ifdef LOADER_THREADS
+	if (loaderRunning)
+	{
+		tail = atomic_load_explicit(&ringTail, memory_order_relaxed);
+		while (atomic_load_explicit(&ringHead, memory_order_acquire) == tail)
+			sched_yield();		// the loader thread is behind
+		pRecord = &ring[tail % LOADER_RING_SIZE];
+		if (pRecord->valid)
+		{	// like readNextProcess(), only the components stored in the trace
+			pProcess->ownerID = pRecord->process.ownerID;
+			pProcess->start = pRecord->process.start;
+			pProcess->duration = pRecord->process.duration;
+			pProcess->size = pRecord->process.size;
+			pProcess->type = pRecord->process.type;
+			consumedOffset = pRecord->nextOffset;
+		}
+		atomic_store_explicit(&ringTail, tail + 1, memory_order_release);
+		return pRecord->valid;
+	}
+#endif
+	return readNextProcess(processFile, pProcess);
+}
+
+#ifdef LOADER_THREADS
+static void* produceRecords(void* argument)
+{	// parses the trace ahead of the core loop until its end
+	FILE* trace = (FILE*)argument;
+	LoaderRecord_t* pRecord;
+	unsigned head = 0;
+	Boolean atEnd;
+
+	do {
+		// backpressure: wait while the ring is full
+		while (head - atomic_load_explicit(&ringTail, memory_order_acquire) == LOADER_RING_SIZE)
+		{
+			if (atomic_load_explicit(&stopRequested, memory_order_relaxed)) return NULL;
+			sched_yield();
+		}
+		pRecord = &ring[head % LOADER_RING_SIZE];
+		atEnd = feof(trace);		// readNextProcess() then closes the trace itself
+		pRecord->valid = readNextProcess(trace, &pRecord->process);
+		pRecord->nextOffset = pRecord->valid ? (long long)ftell(trace) : 0;
+		if (!pRecord->valid)
+		{	// the thread owns the trace until its end
+			if (!atEnd) fclose(trace);
+			traceClosed = TRUE;
+		}
+		head++;
+		atomic_store_explicit(&ringHead, head, memory_order_release);
+	} while (pRecord->valid && !atomic_load_explicit(&stopRequested, memory_order_relaxed));
+	return NULL;
+}
+#endif
@@ -10,11 +10,14 @@
 
 
 FILE* openConfigFile (FILE *file, const char * filename);
-/* opens the  process info file specified by <filename>						*/
+/* opens the  process info file specified by <filename>, "-" is stdin		*/
 /* file has to refer to a valid FILE handle in the calling instance			*/
 /* returns the file handle (which is NULL on error)							*/
 /* Data in the file must be read using the function readNextProcess()		*/
 
+void parseProcessRecord(const char* line, PCB_t* pProcess);
+/* sets the components stored in the trace from one line of it				*/
+
 PCB_t* getNewPCBptr(void);
 /* returns a pointer to the PCB of the process to start */			
 
@@ -27,6 +30,27 @@ Boolean readNextProcess (FILE* f, PCB_t* pProcess);
 /* handle was invalid (NULL) or EOF was reached								*/
 /* returns TRUE on success 													*/
 
+// number of records the loader thread may parse ahead of the core loop
+#define LOADER_RING_SIZE 1024
+
+extern Boolean loaderThreadEnabled;	// parse the trace in a thread, FALSE by default
+
+Boolean startLoaderThread(void);
+/* starts a thread that reads the opened trace ahead and passes the records	*/
+/* to checkForProcessInBatch() through a lock-free single producer/single	*/
+/* consumer ring. The thread waits while the ring is full.					*/
+/* Only if loaderThreadEnabled is set and threads are available (POSIX),	*/
+/* otherwise the trace is read inline. Returns TRUE if the thread runs		*/
+
+void stopLoaderThread(void);
+/* waits for the end of the loader thread, also if it still reads. The		*/
+/* thread closes the trace at its end, processFile is then NULL; otherwise	*/
+/* the trace continues at the first record not yet handed to the core loop	*/
+
+long long loaderOffset(void);
+/* returns the trace position of the first record not yet handed to the		*/
+/* core loop, used for checkpoints											*/
+
 Boolean checkForProcessInBatch(void);
 /* simlation function that checks the file containing the processes to run	*/
 /* if it contains a further process to run, this is storet in the global	*/
@@ -1,56 +1,111 @@
 /* Implementation of the log functions */
 #include "globals.h"
 #include <math.h>
+#include <time.h>
 #include "bs_types.h"
 #include "log.h"
+#include "stats.h"
+#include "probe.h"
+#include "segment.h"
+#include "quickfit.h"
+
+/* data type of a recorded change of the memory state */
+typedef struct
+{
+    MemoryChange_t change;
+    unsigned pid;
+    unsigned start;
+    unsigned size;
+    unsigned to;        // new start of a moved process or a split block
+    unsigned toSize;    // size of the rest of a split block
+} MemoryChangeRecord_t;
 
 /* Global variables */
 char eventString[3][12] = { "completed", "io", "quantumOver" };
+unsigned logLevel = LOG_LEVEL_DEBUG;
+MemoryLogMode_t memoryLogMode = memoryLogFull;
+unsigned keyframeInterval = MEMORY_LOG_DEFAULT_KEYFRAME;
+
+/* Variables visible only in this file */
+static MemoryChangeRecord_t changes[MEMORY_LOG_MAX_CHANGES];
+static unsigned changeCount = 0;
+static Boolean changesComplete = FALSE;     // all changes since the last snapshot recorded
+static unsigned deltasSinceKeyframe = 0;
+static unsigned lastLoggedSystemTime = 0;
+
+static void recordChange(MemoryChange_t change, unsigned pid, unsigned start,
+    unsigned size, unsigned to, unsigned toSize);
+static void logFullMemoryState(void);
+static void logMemoryDelta(void);
 
 void logGeneric(const char* message)
 {
+    if (logLevel < LOG_LEVEL_INFO) return;
+    PROBE_BEGIN(probeLog);
     printf("%6u : %s\n", systemTime, message);
+    PROBE_END(probeLog);
 }
 
 void logPid(unsigned pid, const char* message)
 {
+    if (logLevel < LOG_LEVEL_INFO) return;
+    PROBE_BEGIN(probeLog);
     printf("%6u : PID %3u : %s\n", systemTime, pid, message);
+    PROBE_END(probeLog);
 }
 
 void logPidCompleteness(unsigned pid, unsigned done, unsigned length, const char* message)
 {
+    if (logLevel < LOG_LEVEL_INFO) return;
+    PROBE_BEGIN(probeLog);
     printf("%6u : PID %3u : completeness: %u/%u | %s\n",
         systemTime, pid, done, length, message);
+    PROBE_END(probeLog);
 }
 
 void logPidMem(unsigned pid, const char* message)
 {
+    if (logLevel < LOG_LEVEL_INFO) return;
+    PROBE_BEGIN(probeLog);
     printf("%6u : PID %3u : Used memory: %6u | %s\n",
         systemTime, pid, usedMemory, message);
+    PROBE_END(probeLog);
 }
 
 void logMemoryAllocation(unsigned pid, unsigned size, unsigned start)
 {
+    if (logLevel < LOG_LEVEL_INFO) return;
+    PROBE_BEGIN(probeLog);
     printf("%6u : PID %3u : Allocated memory block - Start: %6u, Size: %6u\n",
         systemTime, pid, start, size);
+    PROBE_END(probeLog);
 }
 
 void logMemoryDeallocation(unsigned pid, unsigned size, unsigned start)
 {
+    if (logLevel < LOG_LEVEL_INFO) return;
+    PROBE_BEGIN(probeLog);
     printf("%6u : PID %3u : Freed memory block - Start: %6u, Size: %6u\n",
         systemTime, pid, start, size);
+    PROBE_END(probeLog);
 }
 
 void logMemoryCompaction(unsigned movedBytes)
 {
+    if (logLevel < LOG_LEVEL_INFO) return;
+    PROBE_BEGIN(probeLog);
     printf("%6u : Memory compaction completed - Moved %u bytes\n",
         systemTime, movedBytes);
+    PROBE_END(probeLog);
 }
 
 void logLoadedProcessData(PCB_t* pProcess)
 {
     const char* processTypeStr;
 
+    if (logLevel < LOG_LEVEL_INFO) return;
+    PROBE_BEGIN(probeLog);
+
     switch (pProcess->type) {
     case os:          processTypeStr = "os"; break;
     case interactive: processTypeStr = "interactive"; break;
@@ -63,16 +118,147 @@ void logLoadedProcessData(PCB_t* pProcess)
     printf("%6u : Sim: Loaded process properties: %u %u %u %u %s\n",
         systemTime, pProcess->ownerID, pProcess->start, pProcess->duration,
         pProcess->size, processTypeStr);
+    PROBE_END(probeLog);
 }
 
-void logMemoryState() {
-    static unsigned lastLoggedSystemTime = 0;
+Boolean parseMemoryLogMode(const char* name)
+{
+    if (strcmp(name, "full") == 0) memoryLogMode = memoryLogFull;
+    else if (strcmp(name, "delta") == 0) memoryLogMode = memoryLogDelta;
+    else return FALSE;
+    return TRUE;
+}
+
+void resetMemoryLog(void)
+{
+    changeCount = 0;
+    changesComplete = FALSE;
+    deltasSinceKeyframe = 0;
+    lastLoggedSystemTime = 0;
+}
 
+void logProcessChange(MemoryChange_t change, unsigned pid, unsigned start,
+    unsigned size, unsigned to)
+{
+    recordChange(change, pid, start, size, to, 0);
+}
+
+void logBlockChange(MemoryChange_t change, unsigned start, unsigned size,
+    unsigned newStart, unsigned newSize)
+{
+    recordChange(change, 0, start, size, newStart, newSize);
+}
+
+double nowNs(void)
+{   // timings of the arena, probes, control socket, pacing and benchmarks
+    struct timespec ts;
+#ifdef _WIN32
+    timespec_get(&ts, TIME_UTC);
+#else
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+void logMemoryState() {
+    if (logLevel < LOG_LEVEL_DEBUG) return;
     if (systemTime == lastLoggedSystemTime) {
         return;
     }
     lastLoggedSystemTime = systemTime;
+    PROBE_BEGIN(probeLogMemoryState);
 
+    if (memoryLogMode == memoryLogFull) {
+        logFullMemoryState();
+    }
+    else if (!changesComplete || deltasSinceKeyframe >= keyframeInterval) {
+        // keyframe, the following deltas refer to it
+        logFullMemoryState();
+        changeCount = 0;
+        changesComplete = TRUE;
+        deltasSinceKeyframe = 0;
+    }
+    else if (changeCount > 0) {
+        logMemoryDelta();
+        changeCount = 0;
+        deltasSinceKeyframe++;
+    }
+    PROBE_END(probeLogMemoryState);
+}
+
+/* ---------------------------------------------------------------- */
+/*                       Local helper functions                     */
+
+static void recordChange(MemoryChange_t change, unsigned pid, unsigned start,
+    unsigned size, unsigned to, unsigned toSize)
+{
+    MemoryChangeRecord_t* pRecord;
+
+    if (memoryLogMode != memoryLogDelta) return;
+    if (logLevel < LOG_LEVEL_DEBUG || changeCount == MEMORY_LOG_MAX_CHANGES) {
+        // a gap in the changes, the next snapshot needs a keyframe
+        changesComplete = FALSE;
+        return;
+    }
+    if (!changesComplete) return;   // discarded by the next keyframe anyway
+    pRecord = &changes[changeCount++];
+    pRecord->change = change;
+    pRecord->pid = pid;
+    pRecord->start = start;
+    pRecord->size = size;
+    pRecord->to = to;
+    pRecord->toSize = toSize;
+}
+
+static void logMemoryDelta(void)
+{
+    MemoryStats_t stats;
+    const MemoryChangeRecord_t* pRecord;
+
+    printf("--- Memory Delta at Time %u (%u changes) ---\n", systemTime, changeCount);
+    for (pRecord = changes; pRecord < changes + changeCount; pRecord++) {
+        switch (pRecord->change) {
+        case memoryPlaced:
+            printf("placed  PID: %3u | Start: %6u | Size: %6u\n",
+                pRecord->pid, pRecord->start, pRecord->size);
+            break;
+        case memoryRemoved:
+            printf("removed PID: %3u | Start: %6u | Size: %6u\n",
+                pRecord->pid, pRecord->start, pRecord->size);
+            break;
+        case memoryMoved:
+            printf("moved   PID: %3u | Start: %6u -> %6u | Size: %6u\n",
+                pRecord->pid, pRecord->start, pRecord->to, pRecord->size);
+            break;
+        case memorySegmentMoved:
+            printf("moved   SEG: %3u | Start: %6u -> %6u | Size: %6u\n",
+                pRecord->pid, pRecord->start, pRecord->to, pRecord->size);
+            break;
+        case memoryBlockTaken:
+            printf("taken   Free | Start: %6u | Size: %6u\n", pRecord->start, pRecord->size);
+            break;
+        case memoryBlockSplit:
+            printf("split   Free | Start: %6u | Size: %6u -> Start: %6u | Size: %6u\n",
+                pRecord->start, pRecord->size, pRecord->to, pRecord->toSize);
+            break;
+        case memoryBlockFreed:
+            printf("freed   Free | Start: %6u | Size: %6u\n", pRecord->start, pRecord->size);
+            break;
+        case memoryBlockMerged:
+            printf("merged  Free | Start: %6u | Size: %6u\n", pRecord->start, pRecord->size);
+            break;
+        case memoryBlocksCleared:
+            printf("cleared Free list\n");
+            break;
+        }
+    }
+    getStats(&stats);
+    printf("Total Used: %6u | Total Free: %6u | Largest Free: %6u | Fragmentation: %5.1f%%\n",
+        usedMemory, stats.totalFree, stats.largestFree, stats.fragmentation / 10.0);
+}
+
+static void logFullMemoryState(void)
+{
     printf("\n========================================\n");
     printf(" Memory State at Time %u\n", systemTime);
     printf("========================================\n");
@@ -87,6 +273,11 @@ void logMemoryState() {
         totalFree += current->size;
         current = current->next;
     }
+    if (quickFitCachedUnits() > 0) {
+        // free as well, but only for processes of the cached sizes
+        printf("Quick-fit cached: %6u\n", quickFitCachedUnits());
+        totalFree += quickFitCachedUnits();
+    }
 
     // Running processes
     printf("----------------------------------------\n");
@@ -102,12 +293,12 @@ void logMemoryState() {
             totalUsed += processTable[i].size;
         }
     }
+    totalUsed += logStandaloneSegments();
 
     // Summary
     printf("----------------------------------------\n");
     printf("Memory Usage Summary:\n");
-    printf("Total Used: %6u | Total Free: %6u | Fragmentation: %6u\n",
-        totalUsed, totalFree,
-        (totalFree > 0) ? (FreeBlock_t*)freeList->next != NULL : 0);
+    printf("Total Used: %6u | Total Free: %6u | Largest Free: %6u | Fragmentation: %5.1f%%\n",
+        totalUsed, totalFree, statsLargestFreeBlock(), statsFragmentation() / 10.0);
     printf("========================================\n\n");
-}
\ No newline at end of file
+}
@@ -14,25 +14,60 @@
 #include "globals.h"
 #include "loader.h"
 
+// verbosity levels of the log output
+#define LOG_LEVEL_OFF	0	// no log output at all
+#define LOG_LEVEL_INFO	1	// event messages only
+#define LOG_LEVEL_DEBUG	2	// event messages and full memory state dumps
 
-void logGeneric(char* message);
+extern unsigned logLevel;	// current verbosity, LOG_LEVEL_DEBUG by default
+
+/* data type for the output of logMemoryState() */
+typedef enum
+	{
+		memoryLogFull,		// every snapshot is a full dump
+		memoryLogDelta		// the changes since the previous snapshot, full
+							// dumps only as keyframes
+	} MemoryLogMode_t;
+
+/* data type naming the changes of the memory state in delta mode */
+typedef enum
+	{
+		memoryPlaced,		// process placed at start
+		memoryRemoved,		// process at start removed
+		memoryMoved,		// process moved from start to another start
+		memorySegmentMoved,	// standalone segment moved, its id in place of the pid
+		memoryBlockTaken,	// free block used completely
+		memoryBlockSplit,	// part of a free block used, the rest is a block
+		memoryBlockFreed,	// new free block
+		memoryBlockMerged,	// free block grown by absorbing adjacent blocks
+		memoryBlocksCleared	// free list discarded, rebuilt by freed blocks
+	} MemoryChange_t;
+
+#define MEMORY_LOG_DEFAULT_KEYFRAME	100		// delta snapshots between two full dumps
+#define MEMORY_LOG_MAX_CHANGES		1024	// more changes between two snapshots
+											// give a full dump instead
+
+extern MemoryLogMode_t memoryLogMode;	// memoryLogFull by default
+extern unsigned keyframeInterval;		// delta snapshots per full dump
+
+void logGeneric(const char* message);
 /* print the given general string to stdout and/or a log file 				*/
 /* The time stamp (systemTime) will be prepended automatically				*/
 /* the linefeed is automatically appended									*/
 
-void logPid(unsigned pid, char* message);
+void logPid(unsigned pid, const char* message);
 /* print the given  string to stdout and/or a log file 						*/
 /* The time stamp (systemTime) and the  PID are prepended automatically		*/
 /* the linefeed is automatically appended									*/
 
 void logPidCompleteness(unsigned pid, unsigned done, unsigned length, 
-						char * message);
+						const char * message);
 /* print the given  string to stdout and/or a log file 						*/
 /* The time stamp (systemTime) and the  PID are prepended automatically		*/
 /* the fraction of used CPU over process duratiuon is also prepended		*/
 /* the linefeed is automatically appended									*/
 
-void logPidMem(unsigned pid, char * message);
+void logPidMem(unsigned pid, const char * message);
 /* print the given  string to stdout and/or a log file 						*/
 /* The time stamp (systemTime) and the  PID are prepended automatically		*/
 /* the currenty used amount of physical memory is also prepended		    */
@@ -49,6 +84,33 @@ void logMemoryState(void);
 /* - Allocated memory with process details (PID, start, size, status)   */
 /* The time stamp (systemTime) is automatically prepended.              */
 /* Output is formatted for clear readability.                           */
+/* In delta mode only the changes recorded since the previous snapshot	*/
+/* are printed, followed by the usage summary; every keyframeInterval	*/
+/* snapshots, and whenever changes were not recorded, a full dump is	*/
+/* printed instead. Snapshots without changes print nothing.			*/
+/* Only the dumps shrink, not the event lines of LOG_LEVEL_INFO. With	*/
+/* MEMORY_SIZE units few processes are resident, so a full dump is only	*/
+/* two to three times as long as a delta.								*/
+
+Boolean parseMemoryLogMode(const char* name);
+/* sets memoryLogMode from its name "full" or "delta"					*/
+/* returns FALSE for an unknown name									*/
+
+void resetMemoryLog(void);
+/* discards the recorded changes, the next snapshot is a full dump,		*/
+/* called at start of a run												*/
+
+void logProcessChange(MemoryChange_t change, unsigned pid, unsigned start,
+					  unsigned size, unsigned to);
+/* records memoryPlaced, memoryRemoved or memoryMoved (to the start to)	*/
+/* of a process, or memorySegmentMoved of a standalone segment with its		*/
+/* id as pid, for the next delta snapshot									*/
+
+void logBlockChange(MemoryChange_t change, unsigned start, unsigned size,
+					unsigned newStart, unsigned newSize);
+/* records a change of the free list for the next delta snapshot:		*/
+/* the block start/size is taken, split into newStart/newSize, freed or	*/
+/* merged into start/size; newStart and newSize are used only by split	*/
 
 
 #endif /* __LOG__ */
\ No newline at end of file
@@ -5,6 +5,19 @@
 #include "globals.h"
 #include "loader.h"
 #include "core.h"
+#include "summary.h"
+#include "stats.h"
+#include "quickfit.h"
+#include "executer.h"
+#include "numa.h"
+#include "checkpoint.h"
+#include "arena.h"
+#include "admission.h"
+#include "probe.h"
+#include "control.h"
+#include "segment.h"
+#include "stream.h"
+#include "shard.h"
 #include <time.h>
 
 
@@ -13,44 +26,635 @@
 /* Declare global variables according to definition in globals.h	*/
 PCB_t processTable[MAX_PROCESSES]; 	// the process table
 unsigned systemTime=0; 			// the current system time (up time)
-extern unsigned usedMemory=0;	// amount of used physical memory
+unsigned usedMemory=0;			// amount of used physical memory
 unsigned runningCount = 0;			// counter of currently running processes
 Boolean batchComplete = FALSE;		// end of pending processes in the file indicator
 FILE* processFile;			// file containing the processes to simulate
 PCB_t candidateProcess;		// only for simulation purposes
+unsigned simSeed = 0;		// seed of the random number generator of this run
 
 /* ----------------------------------------------------------------	*/
 /* Declarations of global variables visible only in this file 		*/
+static const char* traceFilename = PROCESS_FILENAME;	// --trace
+static const char* summaryFilename = NULL;	// --summary, "-" for stdout
+static const char* goldenFilename = NULL;	// --golden
+static const char* regressFilename = NULL;	// --regress
+static Boolean updateGolden = FALSE;		// --update-golden
+static Boolean seedGiven = FALSE;			// --seed was given
+static Boolean logLevelGiven = FALSE;		// --quiet or --log-level was given
+static const char* statsFilename = "-";		// --stats-file
+static unsigned statsInterval = 0;			// --stats-interval, 0 = no snapshots
+static const char* checkpointFilename = "memsim-%u.ckpt";	// --checkpoint-file
+static unsigned checkpointInterval = 0;		// --checkpoint-every, 0 = no checkpoints
+static const char* restoreFilename = NULL;	// --restore
+static Boolean comparePlacement = FALSE;	// --compare-placement
+static const char* controlPath = NULL;		// --control-socket
+static unsigned policiesGiven = 0;			// RESTORE_... of the policy options given
+static unsigned restoreAt = 0;				// --restore-at, regression entries only
 
 /* ---------------------------------------------------------------- */
 /*                Declarations of local functions                   */
-int initSim();		// initialises the simulation environment
+int initSim(const char* filename, unsigned seed);	// initialises the simulation environment
+Boolean parseArguments(int argc, char* argv[]);	// evaluates the command line
+void printUsage(const char* program);		// lists the command line options
+Boolean runRegression(const char* listFilename);	// runs all workloads of a manifest
+void resetPolicyOptions(void);		// sets all memory management policies to default
+Boolean runPlacementComparison(const char* filename);	// runs the trace with every placement policy
+Boolean runRestoredRegression(const char* trace, unsigned seed);	// a regression entry with --restore-at
 
 
 int main(int argc, char *argv[])
 {	// starting point, all processing is done in called functions
+	Boolean passed = TRUE;
+
+	if (!parseArguments(argc, argv))
+	{
+		printUsage(argv[0]);
+		return EXIT_FAILURE;
+	}
+	if (!seedGiven) simSeed = (unsigned)time(NULL);
+	if (regressFilename != NULL)
+		return runRegression(regressFilename) ? EXIT_SUCCESS : EXIT_FAILURE;
+	if (comparePlacement)
+		return runPlacementComparison(traceFilename) ? EXIT_SUCCESS : EXIT_FAILURE;
+
 	printf ("Starting system. Available memory: %u\n", MEMORY_SIZE );
-	initSim();		// initialise the simulation
-	initOS();		// initialise OS itself
+	setCheckpointOptions(traceFilename, checkpointFilename, checkpointInterval);
+	if (restoreFilename != NULL)
+	{	// continue a previous run, the checkpoint replaces trace, seed and layout,
+		// the policies given on the command line replace the stored ones
+		setRestorePolicies(policiesGiven);
+		if (!restoreCheckpoint(restoreFilename))
+		{
+			fprintf(stderr, "Cannot restore checkpoint %s\n", restoreFilename);
+			return EXIT_FAILURE;
+		}
+	}
+	else if (shardCount > 1)
+	{	// the windows run in child processes, the summary reports the joined run
+		if (!runSharded(traceFilename, simSeed)) return EXIT_FAILURE;
+	}
+	else
+	{
+		if (!initSim(traceFilename, simSeed))	// initialise the simulation
+		{	// scripts rely on the exit status, not on the log
+			fprintf(stderr, "Cannot open trace %s\n", traceFilename);
+			return EXIT_FAILURE;
+		}
+		initOS();		// initialise OS itself
+	}
+	if ((statsInterval > 0) && !openStatsOutput(statsFilename, statsInterval))
+		fprintf(stderr, "Cannot write statistics to %s\n", statsFilename);
 	logGeneric("System Initialised, starting batch");
-	coreLoop();		// start scheduling loop
+	if ((controlPath != NULL) && !startControl(controlPath))
+		fprintf(stderr, "Cannot open control socket %s\n", controlPath);
+	if (shardCount <= 1) startLoaderThread();	// only if enabled, the windows read inline
+	if (restoreFilename != NULL) resumeCoreLoop();	// continue the scheduling loop
+	else if (shardCount <= 1) coreLoop();		// start scheduling loop
+	stopLoaderThread();
+	stopControl();
 	logGeneric("Batch complete, shutting down");
+	closeStatsOutput();
+
+	if (summaryFilename != NULL)
+	{
+		if (strcmp(summaryFilename, "-") == 0) writeSummary(stdout);
+		else
+		{
+			FILE* f = fopen(summaryFilename, "w");
+			if (f == NULL) fprintf(stderr, "Cannot write summary to %s\n", summaryFilename);
+			else
+			{
+				writeSummary(f);
+				fclose(f);
+			}
+		}
+	}
+	if (goldenFilename != NULL)
+	{
+		passed = compareSummaryWithGolden(goldenFilename);
+		printf("Regression: %s %s\n", traceFilename, passed ? "PASSED" : "FAILED");
+	}
 	fflush(stdout);			// make sure the output on the console is complete 
-	return 1; 
+	return passed ? EXIT_SUCCESS : EXIT_FAILURE;
  }
 
 /* ---------------------------------------------------------------- */
 /*                Implementation of local functions                 */
 
-int initSim()
+int initSim(const char* filename, unsigned seed)
 {	// initialises the simulation environment
 
-	char filename[128] = PROCESS_FILENAME;
+	char buffer[64];
 	systemTime = 0;				// reset the system time to zero
+	batchComplete = FALSE;		// a new batch starts
+	candidateProcess.valid = FALSE;	// no process read yet
 								// open the file with process definitions
+	if (followInput)
+	{	// the feed is read by the stream module
+		processFile = NULL;
+		return openStream(filename);
+	}
 	processFile = openConfigFile(processFile, filename);
 	logGeneric("Process info file opened");
-	srand((unsigned)time(NULL));	// init the random number generator
+	simSeed = seed;
+	srand(seed);				// init the random number generator
+	sprintf(buffer, "Random seed: %u", seed);
+	logGeneric(buffer);
+
+	return processFile != NULL;
+}
+
+Boolean parseArguments(int argc, char* argv[])
+{
+	int i;
+
+	for (i = 1; i < argc; i++)
+	{
+		if ((strcmp(argv[i], "--seed") == 0) && (i + 1 < argc))
+		{
+			simSeed = (unsigned)strtoul(argv[++i], NULL, 10);
+			seedGiven = TRUE;
+		}
+		else if ((strcmp(argv[i], "--trace") == 0) && (i + 1 < argc))
+			traceFilename = argv[++i];
+		else if ((strcmp(argv[i], "--summary") == 0) && (i + 1 < argc))
+			summaryFilename = argv[++i];
+		else if ((strcmp(argv[i], "--golden") == 0) && (i + 1 < argc))
+			goldenFilename = argv[++i];
+		else if ((strcmp(argv[i], "--regress") == 0) && (i + 1 < argc))
+			regressFilename = argv[++i];
+		else if ((strcmp(argv[i], "--stats-interval") == 0) && (i + 1 < argc))
+			statsInterval = (unsigned)strtoul(argv[++i], NULL, 10);
+		else if ((strcmp(argv[i], "--stats-file") == 0) && (i + 1 < argc))
+			statsFilename = argv[++i];
+		else if ((strcmp(argv[i], "--checkpoint-every") == 0) && (i + 1 < argc))
+			checkpointInterval = (unsigned)strtoul(argv[++i], NULL, 10);
+		else if ((strcmp(argv[i], "--checkpoint-file") == 0) && (i + 1 < argc))
+			checkpointFilename = argv[++i];
+		else if ((strcmp(argv[i], "--restore") == 0) && (i + 1 < argc))
+			restoreFilename = argv[++i];
+		else if ((strcmp(argv[i], "--restore-at") == 0) && (i + 1 < argc))
+		{
+			restoreAt = (unsigned)strtoul(argv[++i], NULL, 10);
+			if ((restoreAt == 0) || (regressFilename == NULL))
+			{
+				fprintf(stderr, "--restore-at needs a time above 0 and is an option of --regress entries\n");
+				return FALSE;
+			}
+		}
+		else if ((strcmp(argv[i], "--cores") == 0) && (i + 1 < argc))
+		{
+			coreCount = (unsigned)strtoul(argv[++i], NULL, 10);
+			policiesGiven |= RESTORE_CORES;
+			if ((coreCount == 0) || (coreCount > MAX_CORES))
+			{
+				fprintf(stderr, "--cores must be between 1 and %u\n", MAX_CORES);
+				return FALSE;
+			}
+		}
+		else if ((strcmp(argv[i], "--nodes") == 0) && (i + 1 < argc))
+		{
+			nodeCount = (unsigned)strtoul(argv[++i], NULL, 10);
+			policiesGiven |= RESTORE_NODES;
+			if ((nodeCount == 0) || (nodeCount > MAX_NODES))
+			{
+				fprintf(stderr, "--nodes must be between 1 and %u\n", MAX_NODES);
+				return FALSE;
+			}
+		}
+		else if ((strcmp(argv[i], "--numa-policy") == 0) && (i + 1 < argc))
+		{
+			policiesGiven |= RESTORE_NUMA;
+			if (!parseNumaPolicy(argv[++i]))
+			{
+				fprintf(stderr, "Unknown NUMA policy: %s\n", argv[i]);
+				return FALSE;
+			}
+		}
+		else if ((strcmp(argv[i], "--remote-penalty") == 0) && (i + 1 < argc))
+		{
+			remotePenalty = (unsigned)strtoul(argv[++i], NULL, 10);
+			policiesGiven |= RESTORE_NUMA;
+		}
+		else if ((strcmp(argv[i], "--placement") == 0) && (i + 1 < argc))
+		{
+			policiesGiven |= RESTORE_PLACEMENT;
+			if (!parsePlacementPolicy(argv[++i]))
+			{
+				fprintf(stderr, "Unknown placement policy: %s\n", argv[i]);
+				return FALSE;
+			}
+		}
+		else if ((strcmp(argv[i], "--small-threshold") == 0) && (i + 1 < argc))
+		{
+			smallThreshold = (unsigned)strtoul(argv[++i], NULL, 10);
+			policiesGiven |= RESTORE_PLACEMENT;
+		}
+		else if ((strcmp(argv[i], "--admission") == 0) && (i + 1 < argc))
+		{
+			policiesGiven |= RESTORE_ADMISSION;
+			if (!parseAdmissionPolicy(argv[++i]))
+			{
+				fprintf(stderr, "Unknown admission policy: %s\n", argv[i]);
+				return FALSE;
+			}
+		}
+		else if ((strcmp(argv[i], "--window") == 0) && (i + 1 < argc))
+		{
+			admissionWindow = (unsigned)strtoul(argv[++i], NULL, 10);
+			policiesGiven |= RESTORE_WINDOW;
+			if ((admissionWindow == 0) || (admissionWindow > ADMISSION_MAX_WINDOW))
+			{
+				fprintf(stderr, "--window must be between 1 and %u\n", ADMISSION_MAX_WINDOW);
+				return FALSE;
+			}
+		}
+		else if ((strcmp(argv[i], "--max-delay") == 0) && (i + 1 < argc))
+		{
+			maxAdmissionDelay = (unsigned)strtoul(argv[++i], NULL, 10);
+			policiesGiven |= RESTORE_WINDOW;
+		}
+		else if ((strcmp(argv[i], "--owner-quota") == 0) && (i + 1 < argc))
+		{
+			policiesGiven |= RESTORE_OWNERS;
+			if (!parseOwnerSetting(argv[++i], ownerQuota, 0, MEMORY_SIZE))
+			{
+				fprintf(stderr, "--owner-quota needs owner:units or all:units, units up to %u\n", MEMORY_SIZE);
+				return FALSE;
+			}
+		}
+		else if ((strcmp(argv[i], "--owner-weight") == 0) && (i + 1 < argc))
+		{
+			policiesGiven |= RESTORE_OWNERS;
+			if (!parseOwnerSetting(argv[++i], ownerWeight, 1, OWNER_MAX_WEIGHT))
+			{
+				fprintf(stderr, "--owner-weight needs owner:weight or all:weight, weight 1 to %u\n",
+					OWNER_MAX_WEIGHT);
+				return FALSE;
+			}
+		}
+		else if ((strcmp(argv[i], "--shared-image") == 0) && (i + 1 < argc))
+		{
+			sharedImagePercent = (unsigned)strtoul(argv[++i], NULL, 10);
+			policiesGiven |= RESTORE_SEGMENTS;
+			if (sharedImagePercent > SEGMENT_MAX_IMAGE_PERCENT)
+			{
+				fprintf(stderr, "--shared-image must be between 0 and %u\n", SEGMENT_MAX_IMAGE_PERCENT);
+				return FALSE;
+			}
+		}
+		else if ((strcmp(argv[i], "--cow-write") == 0) && (i + 1 < argc))
+		{
+			cowWritePercent = (unsigned)strtoul(argv[++i], NULL, 10);
+			policiesGiven |= RESTORE_SEGMENTS;
+			if (cowWritePercent > 100)
+			{
+				fprintf(stderr, "--cow-write must be between 0 and 100\n");
+				return FALSE;
+			}
+		}
+		else if (strcmp(argv[i], "--compare-placement") == 0)
+			comparePlacement = TRUE;
+		else if (strcmp(argv[i], "--arena") == 0)
+			arenaEnabled = TRUE;
+		else if ((strcmp(argv[i], "--arena-scale") == 0) && (i + 1 < argc))
+		{
+			arenaScale = (unsigned)strtoul(argv[++i], NULL, 10);
+			if (arenaScale == 0)
+			{
+				fprintf(stderr, "--arena-scale must be at least 1\n");
+				return FALSE;
+			}
+			arenaEnabled = TRUE;
+		}
+		else if ((strcmp(argv[i], "--probe-report") == 0) && (i + 1 < argc))
+		{
+			setProbeReportFile(argv[++i]);
+			if (!probesAvailable())
+				fprintf(stderr, "Probes are not compiled in, build with -DMEMSIM_PROBES=ON\n");
+		}
+		else if ((strcmp(argv[i], "--control-socket") == 0) && (i + 1 < argc))
+			controlPath = argv[++i];
+		else if (strcmp(argv[i], "--follow") == 0)
+			followInput = TRUE;
+		else if ((strcmp(argv[i], "--pace") == 0) && (i + 1 < argc))
+		{
+			paceFactor = strtod(argv[++i], NULL);
+			if (paceFactor <= 0.0)
+			{
+				fprintf(stderr, "--pace must be a positive speed factor\n");
+				return FALSE;
+			}
+		}
+		else if ((strcmp(argv[i], "--shards") == 0) && (i + 1 < argc))
+		{
+			shardCount = (unsigned)strtoul(argv[++i], NULL, 10);
+			if ((shardCount < 1) || (shardCount > SHARD_MAX))
+			{
+				fprintf(stderr, "--shards must be between 1 and %u\n", SHARD_MAX);
+				return FALSE;
+			}
+		}
+		else if (strcmp(argv[i], "--loader-thread") == 0)
+			loaderThreadEnabled = TRUE;
+		else if (strcmp(argv[i], "--quickfit") == 0)
+		{
+			quickFitEnabled = TRUE;
+			policiesGiven |= RESTORE_QUICKFIT;
+		}
+		else if (strcmp(argv[i], "--update-golden") == 0)
+			updateGolden = TRUE;
+		else if (strcmp(argv[i], "--quiet") == 0)
+		{
+			logLevel = LOG_LEVEL_OFF;
+			logLevelGiven = TRUE;
+		}
+		else if ((strcmp(argv[i], "--log-level") == 0) && (i + 1 < argc))
+		{
+			logLevel = (unsigned)strtoul(argv[++i], NULL, 10);
+			logLevelGiven = TRUE;
+		}
+		else if ((strcmp(argv[i], "--memory-log") == 0) && (i + 1 < argc))
+		{
+			if (!parseMemoryLogMode(argv[++i]))
+			{
+				fprintf(stderr, "Unknown memory log mode: %s\n", argv[i]);
+				return FALSE;
+			}
+		}
+		else if ((strcmp(argv[i], "--keyframe-every") == 0) && (i + 1 < argc))
+		{
+			keyframeInterval = (unsigned)strtoul(argv[++i], NULL, 10);
+			memoryLogMode = memoryLogDelta;
+		}
+		else
+		{
+			fprintf(stderr, "Unknown or incomplete option: %s\n", argv[i]);
+			return FALSE;
+		}
+	}
+	if (arenaEnabled && segmentsEnabled())
+	{	// the arena moves whole blocks, a segment outliving its process has none
+		fprintf(stderr, "--arena cannot be combined with --shared-image or --cow-write\n");
+		return FALSE;
+	}
+	if (followInput && (restoreFilename != NULL))
+	{
+		fprintf(stderr, "--follow cannot be combined with --restore\n");
+		return FALSE;
+	}
+	if ((shardCount > 1) && ((restoreFilename != NULL) || (restoreAt > 0) || followInput || (paceFactor > 0.0)
+		|| (controlPath != NULL) || (checkpointInterval > 0) || (statsInterval > 0)))
+	{	// the windows run in child processes without log and snapshots
+		fprintf(stderr, "--shards cannot be combined with --restore, --restore-at, --follow, --pace,\n"
+			"--control-socket, --checkpoint-every or --stats-interval\n");
+		return FALSE;
+	}
+	return TRUE;
+}
+
+void printUsage(const char* program)
+{
+	printf("Usage: %s [options]\n", program);
+	printf("  --trace FILE       process file to simulate, \"-\" for stdin (default %s)\n", PROCESS_FILENAME);
+	printf("  --seed N           seed of the random number generator (default: time); reserved,\n");
+	printf("                     the model draws no random numbers yet, so runs do not depend on it\n");
+	printf("  --summary FILE     write the canonical run summary, \"-\" for stdout\n");
+	printf("  --golden FILE      compare the run summary with a stored golden summary\n");
+	printf("  --regress LIST     run all workloads of LIST against their golden summaries\n");
+	printf("  --update-golden    with --regress: rewrite the golden summaries instead\n");
+	printf("  --restore-at T     in a --regress entry: run with the default policies to time T,\n");
+	printf("                     restore the checkpoint of T with the options of the entry\n");
+	printf("  --stats-interval N write a statistics snapshot every N time units\n");
+	printf("  --stats-file FILE  CSV file for the snapshots, \"-\" for stdout (default)\n");
+	printf("  --checkpoint-every N  write a checkpoint every N time units\n");
+	printf("  --checkpoint-file F   checkpoint file, %%u is replaced by the time (default memsim-%%u.ckpt)\n");
+	printf("  --restore FILE     continue the run saved in a checkpoint; policy options given\n");
+	printf("                     replace the stored ones, --cores, --nodes, --numa-policy,\n");
+	printf("                     --remote-penalty, --shared-image and --cow-write must match it\n");
+	printf("  --cores N          number of simulated CPU cores (default 1)\n");
+	printf("  --nodes N          number of memory nodes (default 1)\n");
+	printf("  --numa-policy P    placement on the nodes: local, interleave or spill\n");
+	printf("  --remote-penalty P extra execution time of remote processes in %% (default %u)\n",
+		NUMA_DEFAULT_PENALTY);
+	printf("  --placement P      placement in the free list: first-fit or two-ended\n");
+	printf("  --small-threshold N  two-ended: requests below N units from the high end (default %u)\n",
+		PLACEMENT_DEFAULT_THRESHOLD);
+	printf("  --compare-placement  run the trace with first-fit and two-ended placement\n");
+	printf("  --admission A      admission of waiting processes: fifo, lookahead or fair-share\n");
+	printf("  --window N         lookahead: waiting processes packed at once (default %u)\n",
+		ADMISSION_DEFAULT_WINDOW);
+	printf("  --max-delay D      lookahead, fair-share: waiting time after which a process goes first (default %u)\n",
+		ADMISSION_DEFAULT_MAX_DELAY);
+	printf("  --owner-quota O:U  fair-share: memory units owner O may use, O = all for every owner\n");
+	printf("  --owner-weight O:W fair-share: weight of owner O in the share (default %u)\n",
+		OWNER_DEFAULT_WEIGHT);
+	printf("  --shared-image P   share the first P %% of a process per owner and type (default 0 = off)\n");
+	printf("  --cow-write P      a process joining a running one of its owner and type copies P %%\n");
+	printf("                     of its memory and shares the rest (default 0 = off)\n");
+	printf("  --arena            back the memory by a real buffer, compaction moves bytes\n");
+	printf("  --arena-scale N    bytes per memory unit of the arena, implies --arena (default %u)\n",
+		ARENA_DEFAULT_SCALE);
+	printf("  --probe-report F   write the hot path latencies as JSON (builds with probes)\n");
+	printf("  --control-socket P serve status, pause/resume, checkpoint and loglevel commands at P\n");
+	printf("  --follow           read the trace as a live feed, also \"-\" for stdin or a FIFO;\n");
+	printf("                     EOF waits for more, SIGINT or SIGTERM ends the feed\n");
+	printf("  --pace F           advance the time with the wall clock, %u units per second times F\n",
+		STREAM_UNITS_PER_SECOND);
+	printf("  --shards N         simulate N time windows of the trace in parallel and join them,\n");
+	printf("                     the summary is that of the sequential run (default 1)\n");
+	printf("  --loader-thread    parse the trace in a separate thread\n");
+	printf("  --quickfit         cache freed blocks of the most frequent sizes\n");
+	printf("  --quiet            suppress the log output\n");
+	printf("  --log-level N      0 = off, 1 = events, 2 = events and memory dumps\n");
+	printf("  --memory-log M     memory dumps: full or delta (changes only, default full)\n");
+	printf("  --keyframe-every N delta: full dump after N delta dumps, implies delta (default %u)\n",
+		MEMORY_LOG_DEFAULT_KEYFRAME);
+}
+
+void resetPolicyOptions(void)
+{
+	quickFitEnabled = FALSE;
+	coreCount = 1;
+	nodeCount = 1;
+	numaPolicy = numaLocal;
+	remotePenalty = NUMA_DEFAULT_PENALTY;
+	placementPolicy = placementFirstFit;
+	smallThreshold = PLACEMENT_DEFAULT_THRESHOLD;
+	admissionPolicy = admissionFifo;
+	admissionWindow = ADMISSION_DEFAULT_WINDOW;
+	maxAdmissionDelay = ADMISSION_DEFAULT_MAX_DELAY;
+	resetOwnerSettings();
+	sharedImagePercent = 0;
+	cowWritePercent = 0;
+	shardCount = 1;
+	policiesGiven = 0;
+	restoreAt = 0;
+}
+
+Boolean runRegression(const char* listFilename)
+{	// every line of the manifest reads: <trace file> <golden summary> <seed> [options]
+	// the options select the policies of this run, all others are at default
+	char linebuffer[301];
+	char trace[129], golden[129];
+	char* options[16];
+	int optionCount, consumed;
+	unsigned seed;
+	unsigned passedCount = 0, failedCount = 0;
+	FILE* list;
+	FILE* f;
+
+	list = fopen(listFilename, "r");
+	if (list == NULL)
+	{
+		fprintf(stderr, "Cannot open regression list %s\n", listFilename);
+		return FALSE;
+	}
+	if (!logLevelGiven) logLevel = LOG_LEVEL_OFF;	// summaries only, unless asked for
+	while (fgets(linebuffer, sizeof(linebuffer), list) != NULL)
+	{
+		if ((linebuffer[0] == '#')
+			|| (sscanf(linebuffer, "%128s %128s %u%n", trace, golden, &seed, &consumed) != 3))
+			continue;		// comment or incomplete line
+		optionCount = 1;	// options[0] takes the place of the program name
+		options[0] = (char*)listFilename;
+		options[optionCount] = strtok(linebuffer + consumed, " \t\r\n");
+		while ((options[optionCount] != NULL) && (optionCount < 15))
+			options[++optionCount] = strtok(NULL, " \t\r\n");
+		resetPolicyOptions();
+		if (!parseArguments(optionCount, options))
+		{
+			printf("Regression: %s FAILED (invalid options)\n", trace);
+			failedCount++;
+			continue;
+		}
+		if (restoreAt > 0)
+		{
+			if (!runRestoredRegression(trace, seed))
+			{
+				printf("Regression: %s FAILED (restore at %u failed)\n", trace, restoreAt);
+				failedCount++;
+				continue;
+			}
+		}
+		else if (shardCount > 1)
+		{
+			if (!runSharded(trace, seed))
+			{
+				printf("Regression: %s FAILED (sharded run failed)\n", trace);
+				failedCount++;
+				continue;
+			}
+		}
+		else
+		{
+			if (!initSim(trace, seed))
+			{
+				printf("Regression: %s FAILED (cannot open trace)\n", trace);
+				failedCount++;
+				continue;
+			}
+			initOS();
+			startLoaderThread();	// only if enabled
+			coreLoop();
+			stopLoaderThread();
+		}
+		if (updateGolden)
+		{
+			f = fopen(golden, "w");
+			if (f == NULL)
+			{
+				printf("Regression: %s FAILED (cannot write %s)\n", trace, golden);
+				failedCount++;
+				continue;
+			}
+			writeSummary(f);
+			fclose(f);
+			printf("Regression: %s golden summary updated\n", trace);
+			passedCount++;
+		}
+		else if (compareSummaryWithGolden(golden))
+		{
+			printf("Regression: %s PASSED\n", trace);
+			passedCount++;
+		}
+		else
+		{
+			printf("Regression: %s FAILED\n", trace);
+			failedCount++;
+		}
+	}
+	fclose(list);
+	printf("Regression: %u passed, %u failed\n", passedCount, failedCount);
+	return (failedCount == 0);
+}
+
+Boolean runPlacementComparison(const char* filename)
+{	// the same trace, seed and other policies with every placement policy
+	static const PlacementPolicy_t policies[] = { placementFirstFit, placementTwoEnded };
+	static const char* policyNames[] = { "first-fit", "two-ended" };
+	MemoryStats_t stats;
+	unsigned p;
+
+	if (!logLevelGiven) logLevel = LOG_LEVEL_OFF;	// the comparison only, unless asked for
+	printf("Placement comparison of %s, seed %u, small threshold %u\n", filename, simSeed, smallThreshold);
+	printf("%-10s %11s %14s %12s %12s %9s %11s\n", "policy", "compactions", "per 1000 alloc",
+		"units_moved", "failures", "end_time", "utilization");
+	for (p = 0; p < sizeof(policies) / sizeof(policies[0]); p++)
+	{
+		placementPolicy = policies[p];
+		if (!initSim(filename, simSeed))
+		{
+			fprintf(stderr, "Cannot open trace %s\n", filename);
+			return FALSE;
+		}
+		initOS();
+		startLoaderThread();	// only if enabled
+		coreLoop();
+		stopLoaderThread();
+		getStats(&stats);
+		printf("%-10s %11u %14.2f %12llu %12llu %9u %10.1f%%\n", policyNames[p], stats.compactions,
+			(stats.allocations > 0) ? 1000.0 * stats.compactions / (double)stats.allocations : 0.0,
+			stats.unitsMoved, stats.failures, systemTime, 100.0 * stats.utilization);
+	}
+	return TRUE;
+}
+
+Boolean runRestoredRegression(const char* trace, unsigned seed)
+{	// the run up to restoreAt uses the default policies, the checkpoint of that
+	// time is continued with the policies of the entry
+	static const char* pattern = "regress-restore-%u.ckpt";
+	char filename[CHECKPOINT_PATH_SIZE];
+	unsigned at = restoreAt;
+	unsigned endTime, t;
+	Boolean restored, found;
+	FILE* f;
 
+	setRestorePolicies(policiesGiven);	// the options of the entry, before they are reset
+	resetPolicyOptions();
+	restoreAt = at;		// for the report of the entry
+	if (!initSim(trace, seed)) return FALSE;
+	setCheckpointOptions(trace, pattern, at);
+	coreLoop();
+	endTime = systemTime;
+	setCheckpointOptions(trace, NULL, 0);
+	restored = FALSE;
+	found = FALSE;
+	for (t = at; (t <= endTime) && (t >= at); t++)
+	{	// a checkpoint is named by the instant it was written at, the first
+		// one at or after restoreAt is continued, all are removed
+		sprintf(filename, pattern, t);
+		f = fopen(filename, "rb");
+		if (f == NULL) continue;
+		fclose(f);
+		if (!found) restored = restoreCheckpoint(filename);
+		found = TRUE;
+		remove(filename);
+	}
+	if (!restored) return FALSE;
+	startLoaderThread();	// only if enabled
+	resumeCoreLoop();
+	stopLoaderThread();
 	return TRUE;
 }
@@ -0,0 +1,204 @@
+/* Implementation of the NUMA model of the physical memory */
+/* for comments on the functions see the associated .h-file */
+
+/* ---------------------------------------------------------------- */
+/* Include required external definitions */
+#include "globals.h"
+#include "numa.h"
+#include "checkpoint.h"
+
+/* ----------------------------------------------------------------	*/
+/* Declarations of global variables visible only in this file 		*/
+unsigned nodeCount = 1;
+NumaPolicy_t numaPolicy = numaLocal;
+unsigned remotePenalty = NUMA_DEFAULT_PENALTY;
+
+static unsigned interleaveNext;			// first node tried by the next interleaved placement
+static unsigned nodeUsed[MAX_NODES];	// memory units allocated on the node
+static unsigned long long nodeUsedIntegral[MAX_NODES];	// sum of nodeUsed * elapsed time
+static unsigned lastChange;				// systemTime up to which the integrals are summed up
+static unsigned peakFragmentation[MAX_NODES];	// per node, in permille
+static unsigned localPlacements[MAX_NODES];	// processes placed on their home node
+static unsigned remotePlacements[MAX_NODES];	// processes placed here from other home nodes
+static unsigned long long penaltyTotal;	// execution time added by remote placements
+
+/* ---------------------------------------------------------------- */
+/*                Declarations of local helper functions            */
+static void accountUsage(void);
+static void sampleFragmentation(void);
+
+/* ---------------------------------------------------------------- */
+/*                Externally available functions                    */
+/* ---------------------------------------------------------------- */
+
+Boolean parseNumaPolicy(const char* name)
+{
+	if (strcmp(name, "local") == 0) numaPolicy = numaLocal;
+	else if (strcmp(name, "interleave") == 0) numaPolicy = numaInterleave;
+	else if (strcmp(name, "spill") == 0) numaPolicy = numaSpill;
+	else return FALSE;
+	return TRUE;
+}
+
+void resetNuma(void)
+{
+	interleaveNext = 0;
+	memset(nodeUsed, 0, sizeof(nodeUsed));
+	memset(nodeUsedIntegral, 0, sizeof(nodeUsedIntegral));
+	lastChange = systemTime;
+	memset(peakFragmentation, 0, sizeof(peakFragmentation));
+	memset(localPlacements, 0, sizeof(localPlacements));
+	memset(remotePlacements, 0, sizeof(remotePlacements));
+	penaltyTotal = 0;
+}
+
+unsigned nodeBase(unsigned node)
+{	// rounded up, so that nodeOf() is a single division
+	return (node * MEMORY_SIZE + nodeCount - 1) / nodeCount;
+}
+
+unsigned nodeSize(unsigned node)
+{
+	return nodeBase(node + 1) - nodeBase(node);
+}
+
+unsigned nodeOf(unsigned address)
+{
+	return address * nodeCount / MEMORY_SIZE;
+}
+
+unsigned homeNode(PCB_t* pProcess)
+{
+	return pProcess->ownerID % nodeCount;
+}
+
+unsigned largestPlacement(PCB_t* pProcess)
+{	// the rounding in nodeBase() makes the last nodes smaller than node 0
+	if (numaPolicy == numaLocal) return nodeSize(homeNode(pProcess));
+	return nodeSize(0);
+}
+
+unsigned placementOrder(unsigned home, unsigned order[])
+{
+	unsigned i, first;
+
+	if (numaPolicy == numaLocal)
+	{
+		order[0] = home;
+		return 1;
+	}
+	first = (numaPolicy == numaInterleave) ? interleaveNext : home;
+	for (i = 0; i < nodeCount; i++) order[i] = (first + i) % nodeCount;
+	return nodeCount;
+}
+
+void numaProcessPlaced(PCB_t* pProcess)
+{
+	unsigned node = nodeOf(pProcess->start);
+	unsigned penalty;
+	char buffer[100];
+
+	accountUsage();
+	nodeUsed[node] += pProcess->size;
+	interleaveNext = (node + 1) % nodeCount;
+	if (node == homeNode(pProcess)) localPlacements[node]++;
+	else
+	{	// every access goes to a remote bank, the process runs slower
+		penalty = pProcess->duration * remotePenalty / 100;
+		pProcess->duration += penalty;
+		penaltyTotal += penalty;
+		remotePlacements[node]++;
+		sprintf(buffer, "Process %u placed on remote node %u, duration +%u",
+			pProcess->pid, node, penalty);
+		logGeneric(buffer);
+	}
+	sampleFragmentation();
+}
+
+void numaProcessReleased(PCB_t* pProcess)
+{
+	accountUsage();
+	nodeUsed[nodeOf(pProcess->start)] -= pProcess->size;
+	sampleFragmentation();
+}
+
+void saveNumaCheckpoint(Checkpoint_t* pCheckpoint)
+{
+	pCheckpoint->numa.interleaveNext = interleaveNext;
+	memcpy(pCheckpoint->numa.nodeUsed, nodeUsed, sizeof(nodeUsed));
+	memcpy(pCheckpoint->numa.nodeUsedIntegral, nodeUsedIntegral, sizeof(nodeUsedIntegral));
+	pCheckpoint->numa.lastChange = lastChange;
+	memcpy(pCheckpoint->numa.peakFragmentation, peakFragmentation, sizeof(peakFragmentation));
+	memcpy(pCheckpoint->numa.localPlacements, localPlacements, sizeof(localPlacements));
+	memcpy(pCheckpoint->numa.remotePlacements, remotePlacements, sizeof(remotePlacements));
+	pCheckpoint->numa.penaltyTotal = penaltyTotal;
+}
+
+void restoreNumaCheckpoint(const Checkpoint_t* pCheckpoint)
+{
+	interleaveNext = pCheckpoint->numa.interleaveNext;
+	memcpy(nodeUsed, pCheckpoint->numa.nodeUsed, sizeof(nodeUsed));
+	memcpy(nodeUsedIntegral, pCheckpoint->numa.nodeUsedIntegral, sizeof(nodeUsedIntegral));
+	lastChange = pCheckpoint->numa.lastChange;
+	memcpy(peakFragmentation, pCheckpoint->numa.peakFragmentation, sizeof(peakFragmentation));
+	memcpy(localPlacements, pCheckpoint->numa.localPlacements, sizeof(localPlacements));
+	memcpy(remotePlacements, pCheckpoint->numa.remotePlacements, sizeof(remotePlacements));
+	penaltyTotal = pCheckpoint->numa.penaltyTotal;
+}
+
+void logNumaStatistics(void)
+{
+	char buffer[160];
+	unsigned node;
+
+	if (nodeCount < 2) return;
+	accountUsage();
+	for (node = 0; node < nodeCount; node++)
+	{
+		sprintf(buffer, "Node %u: %u units at %u, utilization %5.1f%%, "
+			"peak fragmentation %5.1f%%, %u local, %u remote placements",
+			node, nodeSize(node), nodeBase(node),
+			(systemTime > 0) ? 100.0 * (double)nodeUsedIntegral[node]
+				/ ((double)systemTime * (double)nodeSize(node)) : 0.0,
+			peakFragmentation[node] / 10.0, localPlacements[node],
+			remotePlacements[node]);
+		logGeneric(buffer);
+	}
+	sprintf(buffer, "Nodes: %llu time units added by remote placements", penaltyTotal);
+	logGeneric(buffer);
+}
+
+/* ----------------------------------------------------------------- */
+/*                       Local helper functions                      */
+/* ----------------------------------------------------------------- */
+
+static void accountUsage(void)
+{	// sums up the usage of all nodes since the last change
+	unsigned node;
+
+	for (node = 0; node < nodeCount; node++)
+		nodeUsedIntegral[node] += (unsigned long long)nodeUsed[node] * (systemTime - lastChange);
+	lastChange = systemTime;
+}
+
+static void sampleFragmentation(void)
+{	// one pass over the free list, its segments are ordered by node
+	unsigned totalFree[MAX_NODES] = { 0 };
+	unsigned largest[MAX_NODES] = { 0 };
+	unsigned node, fragmentation;
+	FreeBlock_t* current;
+
+	if (nodeCount < 2) return;	// the global statistics cover a single node
+	for (current = freeList; current != NULL; current = current->next)
+	{
+		node = nodeOf(current->start);
+		totalFree[node] += current->size;
+		if (current->size > largest[node]) largest[node] = current->size;
+	}
+	for (node = 0; node < nodeCount; node++)
+	{
+		if (totalFree[node] == 0) continue;
+		fragmentation = (unsigned)((totalFree[node] - largest[node]) * 1000ULL / totalFree[node]);
+		if (fragmentation > peakFragmentation[node]) peakFragmentation[node] = fragmentation;
+	}
+}
@@ -0,0 +1,75 @@
+/* Include-file defining the NUMA model of the physical memory				*/
+/* The memory is split into nodeCount nodes (banks) of contiguous address	*/
+/* ranges. Free blocks never span a node boundary, so the address ordered	*/
+/* free list consists of one independent segment per node. Every process	*/
+/* has a home node, derived from its owner, and is charged a penalty on		*/
+/* its execution time if it is placed on another node.						*/
+#ifndef __NUMA__
+#define __NUMA__
+
+#include "bs_types.h"
+
+/* data type for the placement policies of processes on the nodes */
+typedef enum
+	{
+		numaLocal,		// home node only, the process waits until it fits there
+		numaInterleave,	// successive processes round robin over all nodes
+		numaSpill		// home node first, then the next nodes
+	} NumaPolicy_t;
+
+// default extra execution time of a remotely placed process, in percent
+#define NUMA_DEFAULT_PENALTY 30
+
+extern unsigned nodeCount;			// number of memory nodes, 1 by default
+extern NumaPolicy_t numaPolicy;		// placement policy, numaLocal by default
+extern unsigned remotePenalty;		// extra execution time of remote processes in percent
+
+
+Boolean parseNumaPolicy(const char* name);
+/* sets numaPolicy from its name "local", "interleave" or "spill"			*/
+/* returns FALSE for an unknown name										*/
+
+void resetNuma(void);
+/* clears the per-node accounting, called at start of a run					*/
+
+unsigned nodeBase(unsigned node);
+/* returns the first address of the node, nodeBase(nodeCount) is the end	*/
+/* of the memory															*/
+
+unsigned nodeSize(unsigned node);
+/* returns the number of memory units of the node, node 0 is the largest	*/
+
+unsigned nodeOf(unsigned address);
+/* returns the node holding the given address								*/
+
+unsigned homeNode(PCB_t* pProcess);
+/* returns the node local to the process: its owner modulo nodeCount		*/
+
+unsigned largestPlacement(PCB_t* pProcess);
+/* returns the largest process size numaPolicy can ever place for the		*/
+/* process: its home node with local placement, else node 0					*/
+
+unsigned placementOrder(unsigned home, unsigned order[]);
+/* fills order with the nodes to try for a process with the given home node	*/
+/* according to numaPolicy, returns the number of nodes to try				*/
+
+void numaProcessPlaced(PCB_t* pProcess);
+/* accounts the memory of a process that just got its memory. A process on	*/
+/* a remote node gets its duration extended by remotePenalty percent		*/
+
+void numaProcessReleased(PCB_t* pProcess);
+/* accounts the memory of a process that just returned its memory			*/
+
+struct Checkpoint;
+
+void saveNumaCheckpoint(struct Checkpoint* pCheckpoint);
+/* stores the per-node accounting											*/
+
+void restoreNumaCheckpoint(const struct Checkpoint* pCheckpoint);
+/* restores the per-node accounting											*/
+
+void logNumaStatistics(void);
+/* prints utilization, peak fragmentation and local/remote placements of	*/
+/* every node, only if more than one node is simulated						*/
+
+#endif /* __NUMA__ */
@@ -0,0 +1,202 @@
+/* Implementation of the probes measuring the hot paths of the simulator */
+/* for comments on the functions see the associated .h-file */
+
+/* ---------------------------------------------------------------- */
+/* Include required external definitions */
+#include "globals.h"
+#include "probe.h"
+
+/* data type of the measurements of one probe */
+typedef struct
+	{
+		unsigned long long calls;
+		unsigned long long totalTicks;
+		unsigned long long minTicks;
+		unsigned long long maxTicks;
+		unsigned long long buckets[PROBE_BUCKETS];
+	} ProbeData_t;
+
+/* ----------------------------------------------------------------	*/
+/* Declarations of global variables visible only in this file 		*/
+static const char* reportFilename = NULL;	// JSON report, none if NULL
+#ifdef MEMSIM_PROBES
+static const char* probeNames[PROBE_COUNT] = {
+	"findFreeBlock", "freeMemory", "compactMemoryWithSimulation", "runToNextEvent",
+	"updateAllVirtualTimes", "log", "logMemoryState"
+};
+static ProbeData_t probes[PROBE_COUNT];
+static ProbeTicks_t startTicks;		// probeTicks() and nanoseconds at resetProbes(),
+static double startNs;				// for the conversion of ticks to nanoseconds
+#endif
+
+/* ---------------------------------------------------------------- */
+/*                Declarations of local helper functions            */
+#ifdef MEMSIM_PROBES
+static unsigned bucketOf(unsigned long long ticks);
+static unsigned long long bucketLimit(unsigned bucket);
+static unsigned long long percentile(const ProbeData_t* pProbe, double fraction);
+static void writeReport(FILE* f, double nsPerTick);
+#endif
+
+/* ---------------------------------------------------------------- */
+/*                Externally available functions                    */
+/* ---------------------------------------------------------------- */
+
+Boolean probesAvailable(void)
+{
+#ifdef MEMSIM_PROBES
+	return TRUE;
+#else
+	return FALSE;
+#endif
+}
+
+void resetProbes(void)
+{
+#ifdef MEMSIM_PROBES
+	unsigned p;
+
+	memset(probes, 0, sizeof(probes));
+	for (p = 0; p < PROBE_COUNT; p++) probes[p].minTicks = ~0ULL;
+	startTicks = probeTicks();
+	startNs = nowNs();
+#endif
+}
+
+void setProbeReportFile(const char* filename)
+{
+	reportFilename = filename;
+}
+
+#ifdef MEMSIM_PROBES
+void probeRecord(Probe_t probe, ProbeTicks_t ticks)
+{
+	ProbeData_t* pProbe = &probes[probe];
+
+	pProbe->calls++;
+	pProbe->totalTicks += ticks;
+	if (ticks < pProbe->minTicks) pProbe->minTicks = ticks;
+	if (ticks > pProbe->maxTicks) pProbe->maxTicks = ticks;
+	pProbe->buckets[bucketOf(ticks)]++;
+}
+#endif
+
+void dumpProbes(void)
+{
+#ifdef MEMSIM_PROBES
+	char buffer[200];
+	double nsPerTick, elapsedNs;
+	ProbeTicks_t elapsedTicks;
+	ProbeData_t* pProbe;
+	unsigned p;
+	FILE* f;
+
+	// the rate of the time stamp counter, measured over the whole run
+	do {
+		elapsedNs = nowNs() - startNs;
+		elapsedTicks = probeTicks() - startTicks;
+	} while (elapsedNs < 1e7);		// at least 10 ms for a stable rate
+	nsPerTick = elapsedNs / (double)elapsedTicks;
+
+	for (p = 0; p < PROBE_COUNT; p++)
+	{
+		pProbe = &probes[p];
+		if (pProbe->calls == 0) continue;
+		sprintf(buffer, "Probe %s: %llu calls, total %.3f ms, mean %.1f ns, "
+			"p50 %.0f ns, p99 %.0f ns, max %.0f ns",
+			probeNames[p], pProbe->calls, pProbe->totalTicks * nsPerTick / 1e6,
+			pProbe->totalTicks * nsPerTick / (double)pProbe->calls,
+			percentile(pProbe, 0.5) * nsPerTick, percentile(pProbe, 0.99) * nsPerTick,
+			pProbe->maxTicks * nsPerTick);
+		logGeneric(buffer);
+	}
+	if (reportFilename == NULL) return;
+	f = (strcmp(reportFilename, "-") == 0) ? stdout : fopen(reportFilename, "w");
+	if (f == NULL)
+	{
+		fprintf(stderr, "Cannot write probe report to %s\n", reportFilename);
+		return;
+	}
+	writeReport(f, nsPerTick);
+	if (f != stdout) fclose(f);
+#endif
+}
+
+/* ----------------------------------------------------------------- */
+/*                       Local helper functions                      */
+/* ----------------------------------------------------------------- */
+
+#ifdef MEMSIM_PROBES
+static unsigned bucketOf(unsigned long long ticks)
+{	// values below PROBE_SUB_BUCKETS have a bucket each, above that every
+	// power of two is split into PROBE_SUB_BUCKETS buckets
+	unsigned msb = 0;
+
+	if (ticks < PROBE_SUB_BUCKETS) return (unsigned)ticks;
+#if defined(__GNUC__) || defined(__clang__)
+	msb = 63 - (unsigned)__builtin_clzll(ticks);
+#else
+	while ((ticks >> msb) > 1) msb++;
+#endif
+	return (msb - PROBE_SUB_BITS + 1) * PROBE_SUB_BUCKETS
+		+ (unsigned)((ticks >> (msb - PROBE_SUB_BITS)) & (PROBE_SUB_BUCKETS - 1));
+}
+
+static unsigned long long bucketLimit(unsigned bucket)
+{	// the largest value falling into the bucket
+	unsigned msb, sub;
+
+	if (bucket < PROBE_SUB_BUCKETS) return bucket;
+	msb = bucket / PROBE_SUB_BUCKETS + PROBE_SUB_BITS - 1;
+	sub = bucket % PROBE_SUB_BUCKETS;
+	return ((((unsigned long long)PROBE_SUB_BUCKETS + sub + 1) << (msb - PROBE_SUB_BITS))) - 1;
+}
+
+static unsigned long long percentile(const ProbeData_t* pProbe, double fraction)
+{	// upper limit of the bucket holding the given share of the calls
+	unsigned long long rank = (unsigned long long)(fraction * (double)pProbe->calls);
+	unsigned long long seen = 0;
+	unsigned bucket;
+
+	for (bucket = 0; bucket < PROBE_BUCKETS; bucket++)
+	{
+		seen += pProbe->buckets[bucket];
+		if (seen > rank)
+			return (bucketLimit(bucket) < pProbe->maxTicks) ? bucketLimit(bucket) : pProbe->maxTicks;
+	}
+	return pProbe->maxTicks;
+}
+
+static void writeReport(FILE* f, double nsPerTick)
+{	// one object per probe, the histogram as [upper limit in ns, calls] pairs
+	const ProbeData_t* pProbe;
+	unsigned p, bucket;
+	Boolean first;
+
+	fprintf(f, "{\n  \"system_time\": %u,\n  \"ns_per_tick\": %.6f,\n  \"probes\": [", systemTime, nsPerTick);
+	for (p = 0; p < PROBE_COUNT; p++)
+	{
+		pProbe = &probes[p];
+		fprintf(f, "%s\n    {\"name\": \"%s\", \"calls\": %llu, \"total_ns\": %.0f",
+			(p > 0) ? "," : "", probeNames[p], pProbe->calls, pProbe->totalTicks * nsPerTick);
+		if (pProbe->calls > 0)
+			fprintf(f, ", \"min_ns\": %.0f, \"mean_ns\": %.1f, \"p50_ns\": %.0f, \"p90_ns\": %.0f, "
+				"\"p99_ns\": %.0f, \"p999_ns\": %.0f, \"max_ns\": %.0f",
+				pProbe->minTicks * nsPerTick, pProbe->totalTicks * nsPerTick / (double)pProbe->calls,
+				percentile(pProbe, 0.5) * nsPerTick, percentile(pProbe, 0.9) * nsPerTick,
+				percentile(pProbe, 0.99) * nsPerTick, percentile(pProbe, 0.999) * nsPerTick,
+				pProbe->maxTicks * nsPerTick);
+		fprintf(f, ", \"histogram\": [");
+		first = TRUE;
+		for (bucket = 0; bucket < PROBE_BUCKETS; bucket++)
+		{
+			if (pProbe->buckets[bucket] == 0) continue;
+			fprintf(f, "%s[%.1f, %llu]", first ? "" : ", ",
+				bucketLimit(bucket) * nsPerTick, pProbe->buckets[bucket]);
+			first = FALSE;
+		}
+		fprintf(f, "]}");
+	}
+	fprintf(f, "\n  ]\n}\n");
+}
+#endif
@@ -0,0 +1,83 @@
+/* Include-file defining the probes measuring the hot paths of the simulator	*/
+/* A probe counts the calls of a code section and records the duration of	*/
+/* every call in a latency histogram of log2 buckets with PROBE_SUB_BUCKETS	*/
+/* linear sub-buckets each, so the relative error of a percentile is below	*/
+/* 1 / PROBE_SUB_BUCKETS over the whole range. Durations are taken from the	*/
+/* time stamp counter on x86, from the monotonic clock otherwise.			*/
+/* The probes exist only in builds with MEMSIM_PROBES defined (cmake		*/
+/* -DMEMSIM_PROBES=ON); otherwise PROBE_BEGIN/PROBE_END expand to nothing	*/
+/* and the report functions do nothing.										*/
+/* Probes are not thread safe, they are used on the thread of the core loop.	*/
+#ifndef __PROBE__
+#define __PROBE__
+
+#include "bs_types.h"
+
+/* data type naming the probes */
+typedef enum
+	{
+		probeFindFreeBlock,			// findFreeBlock(), findFreeBlockOnNode()
+		probeFreeMemory,			// freeMemory()
+		probeCompaction,			// compactMemoryWithSimulation()
+		probeRunToNextEvent,		// runToNextEvent()
+		probeUpdateVirtualTimes,	// updateAllVirtualTimes()
+		probeLog,					// event messages of log.c, if printed
+		probeLogMemoryState,		// memory state dumps of log.c, if printed
+		PROBE_COUNT
+	} Probe_t;
+
+#define PROBE_SUB_BITS		2
+#define PROBE_SUB_BUCKETS	(1U << PROBE_SUB_BITS)
+#define PROBE_BUCKETS		(64 * PROBE_SUB_BUCKETS)
+
+#ifdef MEMSIM_PROBES
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define PROBE_TSC
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define PROBE_TSC
+#else
+#include <time.h>
+#endif
+
+typedef unsigned long long ProbeTicks_t;
+
+static inline ProbeTicks_t probeTicks(void)
+{	// time stamp counter or nanoseconds of the monotonic clock
+#ifdef PROBE_TSC
+	return __rdtsc();
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (ProbeTicks_t)ts.tv_sec * 1000000000ULL + (ProbeTicks_t)ts.tv_nsec;
+#endif
+}
+
+void probeRecord(Probe_t probe, ProbeTicks_t ticks);
+/* adds one call of the given duration to the probe							*/
+
+// a section is enclosed by PROBE_BEGIN and PROBE_END of the same probe in
+// one block; every return inside the section needs its own PROBE_END
+#define PROBE_BEGIN(probe)	ProbeTicks_t probeStart_##probe = probeTicks()
+#define PROBE_END(probe)	probeRecord(probe, probeTicks() - probeStart_##probe)
+#else
+#define PROBE_BEGIN(probe)	((void)0)
+#define PROBE_END(probe)	((void)0)
+#endif
+
+
+Boolean probesAvailable(void);
+/* returns TRUE if the probes are compiled in								*/
+
+void resetProbes(void);
+/* clears all probes, called at start of a run								*/
+
+void setProbeReportFile(const char* filename);
+/* selects a file for the machine readable report (JSON) of dumpProbes()	*/
+
+void dumpProbes(void);
+/* prints calls, mean and percentiles of every probe that was hit and		*/
+/* writes the report file if one is selected, called at the end of the run	*/
+
+#endif /* __PROBE__ */
@@ -0,0 +1,257 @@
+/* Implementation of the quick-fit layer */
+/* for comments on the functions see the associated .h-file */
+
+/* ---------------------------------------------------------------- */
+/* Include required external definitions */
+#include "globals.h"
+#include "quickfit.h"
+#include "numa.h"
+#include "checkpoint.h"
+#include "stats.h"
+
+/* ----------------------------------------------------------------	*/
+/* Declarations of global variables visible only in this file 		*/
+Boolean quickFitEnabled = FALSE;
+
+// arrival frequencies of candidate sizes (space-saving sketch: a new size
+// replaces the least frequent one and inherits its count)
+static unsigned trackedSize[QUICKFIT_TRACKED];
+static unsigned trackedCount[QUICKFIT_TRACKED];
+static unsigned trackedUsed;
+static unsigned arrivalsSinceRelearn;
+
+// the caches, a size of 0 marks an unused class
+static unsigned classSize[QUICKFIT_CLASSES];
+static unsigned classCount[QUICKFIT_CLASSES];
+static unsigned classStart[QUICKFIT_CLASSES][QUICKFIT_DEPTH];
+
+static unsigned releasesSinceFlush;
+static unsigned long long hits, misses, flushes;
+
+/* ---------------------------------------------------------------- */
+/*                Declarations of local helper functions            */
+static int findClass(unsigned size);
+static void flushClass(int c);
+static void relearnHotSizes(void);
+
+/* ---------------------------------------------------------------- */
+/*                Externally available functions                    */
+/* ---------------------------------------------------------------- */
+
+void resetQuickFit(void)
+{
+	trackedUsed = 0;
+	arrivalsSinceRelearn = 0;
+	memset(classSize, 0, sizeof(classSize));
+	memset(classCount, 0, sizeof(classCount));
+	releasesSinceFlush = 0;
+	hits = 0;
+	misses = 0;
+	flushes = 0;
+}
+
+void quickFitObserve(unsigned size)
+{
+	unsigned i, least = 0;
+
+	if (!quickFitEnabled) return;
+	for (i = 0; i < trackedUsed; i++)
+	{
+		if (trackedSize[i] == size) break;
+		if (trackedCount[i] < trackedCount[least]) least = i;
+	}
+	if (i < trackedUsed) trackedCount[i]++;
+	else if (trackedUsed < QUICKFIT_TRACKED)
+	{
+		trackedSize[trackedUsed] = size;
+		trackedCount[trackedUsed] = 1;
+		trackedUsed++;
+	}
+	else
+	{
+		trackedSize[least] = size;
+		trackedCount[least]++;
+	}
+	if (++arrivalsSinceRelearn >= QUICKFIT_RELEARN) relearnHotSizes();
+}
+
+Boolean quickFitAllocate(unsigned size, unsigned node, unsigned* pStart)
+{
+	int c;
+	unsigned i;
+
+	if (!quickFitEnabled) return FALSE;
+	c = findClass(size);
+	if (c < 0) return FALSE;
+	// the most recently cached block of the node, the last one moves into its place
+	for (i = classCount[c]; (i > 0) && (nodeOf(classStart[c][i - 1]) != node); i--);
+	if (i == 0)
+	{
+		misses++;
+		return FALSE;
+	}
+	*pStart = classStart[c][i - 1];
+	classStart[c][i - 1] = classStart[c][--classCount[c]];
+	statsBlockRemoved(size);
+	hits++;
+	return TRUE;
+}
+
+Boolean quickFitRelease(unsigned start, unsigned size)
+{
+	int c;
+
+	if (!quickFitEnabled) return FALSE;
+	c = findClass(size);
+	if ((c < 0) || (classCount[c] >= QUICKFIT_DEPTH)) return FALSE;
+	classStart[c][classCount[c]++] = start;
+	statsBlockAdded(size);		// a cached block is free memory, only outside the free list
+	if (++releasesSinceFlush >= QUICKFIT_FLUSH_INTERVAL) quickFitFlush();
+	return TRUE;
+}
+
+unsigned quickFitFlush(void)
+{
+	unsigned units = 0;
+	int c;
+
+	for (c = 0; c < QUICKFIT_CLASSES; c++)
+	{
+		units += classCount[c] * classSize[c];
+		flushClass(c);
+	}
+	releasesSinceFlush = 0;
+	if (units > 0) flushes++;
+	return units;
+}
+
+unsigned quickFitCachedUnits(void)
+{
+	unsigned units = 0;
+	int c;
+
+	for (c = 0; c < QUICKFIT_CLASSES; c++) units += classCount[c] * classSize[c];
+	return units;
+}
+
+void quickFitCountCached(void)
+{
+	int c;
+	unsigned i;
+
+	for (c = 0; c < QUICKFIT_CLASSES; c++)
+		for (i = 0; i < classCount[c]; i++) statsBlockAdded(classSize[c]);
+}
+
+void saveQuickFitCheckpoint(Checkpoint_t* pCheckpoint)
+{
+	memcpy(pCheckpoint->quickFit.trackedSize, trackedSize, sizeof(trackedSize));
+	memcpy(pCheckpoint->quickFit.trackedCount, trackedCount, sizeof(trackedCount));
+	pCheckpoint->quickFit.trackedUsed = trackedUsed;
+	pCheckpoint->quickFit.arrivalsSinceRelearn = arrivalsSinceRelearn;
+	memcpy(pCheckpoint->quickFit.classSize, classSize, sizeof(classSize));
+	memcpy(pCheckpoint->quickFit.classCount, classCount, sizeof(classCount));
+	memcpy(pCheckpoint->quickFit.classStart, classStart, sizeof(classStart));
+	pCheckpoint->quickFit.releasesSinceFlush = releasesSinceFlush;
+	pCheckpoint->quickFit.hits = hits;
+	pCheckpoint->quickFit.misses = misses;
+	pCheckpoint->quickFit.flushes = flushes;
+}
+
+void restoreQuickFitCheckpoint(const Checkpoint_t* pCheckpoint)
+{
+	memcpy(trackedSize, pCheckpoint->quickFit.trackedSize, sizeof(trackedSize));
+	memcpy(trackedCount, pCheckpoint->quickFit.trackedCount, sizeof(trackedCount));
+	trackedUsed = pCheckpoint->quickFit.trackedUsed;
+	arrivalsSinceRelearn = pCheckpoint->quickFit.arrivalsSinceRelearn;
+	memcpy(classSize, pCheckpoint->quickFit.classSize, sizeof(classSize));
+	memcpy(classCount, pCheckpoint->quickFit.classCount, sizeof(classCount));
+	memcpy(classStart, pCheckpoint->quickFit.classStart, sizeof(classStart));
+	releasesSinceFlush = pCheckpoint->quickFit.releasesSinceFlush;
+	hits = pCheckpoint->quickFit.hits;
+	misses = pCheckpoint->quickFit.misses;
+	flushes = pCheckpoint->quickFit.flushes;
+}
+
+void logQuickFitStatistics(void)
+{
+	char buffer[160];
+	int c, n = 0;
+
+	if (!quickFitEnabled) return;
+	n = sprintf(buffer, "Quick-fit: %llu hits, %llu misses, %llu flushes, hot sizes:",
+		hits, misses, flushes);
+	for (c = 0; c < QUICKFIT_CLASSES; c++)
+		if (classSize[c] > 0) n += sprintf(buffer + n, " %u", classSize[c]);
+	logGeneric(buffer);
+}
+
+/* ----------------------------------------------------------------- */
+/*                       Local helper functions                      */
+/* ----------------------------------------------------------------- */
+
+static int findClass(unsigned size)
+{	// index of the cache for the given size, -1 if the size is not hot
+	int c;
+
+	for (c = 0; c < QUICKFIT_CLASSES; c++)
+		if (classSize[c] == size) return (size > 0) ? c : -1;
+	return -1;
+}
+
+static void flushClass(int c)
+{
+	while (classCount[c] > 0)
+	{
+		classCount[c]--;
+		statsBlockRemoved(classSize[c]);	// freeMemory() counts it again
+		freeMemory(classStart[c][classCount[c]], classSize[c]);
+	}
+}
+
+static void relearnHotSizes(void)
+{	// the most frequent sizes seen at least twice become the hot sizes
+	unsigned hot[QUICKFIT_CLASSES] = { 0 };
+	unsigned hotCount[QUICKFIT_CLASSES] = { 0 };
+	unsigned i, j, k;
+	int c, slot;
+
+	for (i = 0; i < trackedUsed; i++)
+	{	// insertion into the top list, ordered by descending count
+		if (trackedCount[i] < 2) continue;
+		for (j = 0; j < QUICKFIT_CLASSES; j++)
+		{
+			if (trackedCount[i] > hotCount[j])
+			{
+				for (k = QUICKFIT_CLASSES - 1; k > j; k--)
+				{
+					hot[k] = hot[k - 1];
+					hotCount[k] = hotCount[k - 1];
+				}
+				hot[j] = trackedSize[i];
+				hotCount[j] = trackedCount[i];
+				break;
+			}
+		}
+	}
+	// sizes that are no longer hot give their blocks back
+	for (c = 0; c < QUICKFIT_CLASSES; c++)
+	{
+		for (j = 0; j < QUICKFIT_CLASSES; j++) if (hot[j] == classSize[c]) break;
+		if (j == QUICKFIT_CLASSES)
+		{
+			flushClass(c);
+			classSize[c] = 0;
+		}
+	}
+	// new hot sizes take the unused classes
+	for (j = 0; j < QUICKFIT_CLASSES; j++)
+	{
+		if ((hot[j] == 0) || (findClass(hot[j]) >= 0)) continue;
+		for (slot = 0; classSize[slot] != 0; slot++);
+		classSize[slot] = hot[j];
+	}
+	// age the counts, so the hot sizes follow changes of the workload
+	for (i = 0; i < trackedUsed; i++) trackedCount[i] /= 2;
+	arrivalsSinceRelearn = 0;
+}
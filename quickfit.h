@@ -0,0 +1,63 @@
+/* Include-file defining the quick-fit layer of the memory manager			*/
+/* Freed blocks of the most frequent process sizes are kept in exact-size	*/
+/* caches instead of being merged into the free list, so the next arrival	*/
+/* of the same size gets them without searching, splitting or merging.		*/
+/* The hot sizes are learned from the arrival stream. The caches are		*/
+/* flushed back into the free list periodically, before a compaction and	*/
+/* when a request cannot be served otherwise, to bound fragmentation.		*/
+#ifndef __QUICKFIT__
+#define __QUICKFIT__
+
+#include "bs_types.h"
+
+// number of sizes with an own cache
+#define QUICKFIT_CLASSES	5
+// maximum number of cached blocks per size
+#define QUICKFIT_DEPTH		8
+// number of candidate sizes whose arrival frequency is tracked
+#define QUICKFIT_TRACKED	32
+// arrivals between two re-evaluations of the hot sizes
+#define QUICKFIT_RELEARN	16
+// releases between two periodic flushes of all caches
+#define QUICKFIT_FLUSH_INTERVAL	256
+
+extern Boolean quickFitEnabled;	// quick-fit layer active, FALSE by default
+
+
+void resetQuickFit(void);
+/* drops all caches and the learned sizes, called at start of a run		*/
+
+void quickFitObserve(unsigned size);
+/* feeds the size of an arriving process into the learning of hot sizes	*/
+
+Boolean quickFitAllocate(unsigned size, unsigned node, unsigned* pStart);
+/* takes a cached block of exactly the given size on the given memory node,	*/
+/* start is stored in pStart												*/
+/* returns FALSE if no such block is cached								*/
+
+Boolean quickFitRelease(unsigned start, unsigned size);
+/* caches the released block if its size is hot and the cache has room		*/
+/* returns FALSE if the block was not taken and must go to the free list	*/
+
+unsigned quickFitFlush(void);
+/* returns all cached blocks to the free list, returns the number of units	*/
+
+unsigned quickFitCachedUnits(void);
+/* returns the number of memory units currently held in the caches			*/
+
+void quickFitCountCached(void);
+/* adds the cached blocks to the free block statistics, which count them	*/
+/* as free memory; called when the statistics are rebuilt					*/
+
+struct Checkpoint;
+
+void saveQuickFitCheckpoint(struct Checkpoint* pCheckpoint);
+/* stores the learned sizes and the cached blocks							*/
+
+void restoreQuickFitCheckpoint(const struct Checkpoint* pCheckpoint);
+/* restores the learned sizes and the cached blocks							*/
+
+void logQuickFitStatistics(void);
+/* prints hits, misses and flushes of the caches							*/
+
+#endif /* __QUICKFIT__ */
@@ -0,0 +1,353 @@
+/* Implementation of shared and copy-on-write memory segments */
+/* for comments on the functions see the associated .h-file */
+
+/* ---------------------------------------------------------------- */
+/* Include required external definitions */
+#include "globals.h"
+#include "segment.h"
+#include "numa.h"
+#include "stats.h"
+#include "checkpoint.h"
+
+/* ----------------------------------------------------------------	*/
+/* Declarations of global variables visible only in this file 		*/
+unsigned sharedImagePercent = 0;
+unsigned cowWritePercent = 0;
+
+static Segment_t segments[SEGMENT_MAX];	// segment id n is segments[n - 1]
+static unsigned imageOf[SEGMENT_KEYS];	// current image per owner and type, 0 = none
+static unsigned parentOf[SEGMENT_KEYS];	// private memory of the current parent
+static unsigned imageCount;				// images created
+static unsigned attachedCount;			// processes that referenced an image
+static unsigned childCount;				// processes that referenced a parent
+static unsigned standaloneCount;		// segments that outlived their holder
+static unsigned logicalUsed;			// usedMemory without any sharing
+static long long savedNow;				// logicalUsed - usedMemory
+static long long savedPeak;
+static long long savedIntegral;			// sum of savedNow * elapsed time
+static unsigned lastSavedChange;		// systemTime up to which the integral is summed up
+
+/* ---------------------------------------------------------------- */
+/*                Declarations of local helper functions            */
+static unsigned keyOf(const PCB_t* pProcess);
+static unsigned newSegment(SegmentKind_t kind, unsigned key, pid_t holder, unsigned offset, unsigned size);
+static void forgetSegment(unsigned id);
+static void dropReference(unsigned id);
+static void releaseRange(unsigned start, unsigned size);
+static void accumulateSaved(void);
+static void updateSaved(void);
+
+/* ---------------------------------------------------------------- */
+/*                Externally available functions                    */
+/* ---------------------------------------------------------------- */
+
+Boolean segmentsEnabled(void)
+{
+	return (sharedImagePercent > 0) || (cowWritePercent > 0);
+}
+
+void resetSegments(void)
+{
+	memset(segments, 0, sizeof(segments));
+	memset(imageOf, 0, sizeof(imageOf));
+	memset(parentOf, 0, sizeof(parentOf));
+	imageCount = 0;
+	attachedCount = 0;
+	childCount = 0;
+	standaloneCount = 0;
+	logicalUsed = 0;
+	savedNow = 0;
+	savedPeak = 0;
+	savedIntegral = 0;
+	lastSavedChange = systemTime;
+}
+
+void segmentAttach(PCB_t* pProcess)
+{
+	unsigned key, id, share;
+	Segment_t* pSegment;
+
+	if (!segmentsEnabled()) return;
+	key = keyOf(pProcess);
+	id = imageOf[key];
+	if ((sharedImagePercent > 0) && (id != 0))
+	{	// the image is as large as that of the process, at most as the existing one
+		pSegment = &segments[id - 1];
+		share = pProcess->size * sharedImagePercent / 100;
+		if (share > pSegment->size) share = pSegment->size;
+		if (share > 0)
+		{
+			pSegment->refs++;
+			pProcess->imageSegment = id;
+			pProcess->size -= share;
+			pProcess->sharedSize += share;
+			attachedCount++;
+		}
+	}
+	id = parentOf[key];
+	if ((cowWritePercent > 0) && (id != 0))
+	{	// the pages the child does not write stay shared with the parent
+		pSegment = &segments[id - 1];
+		share = ((pProcess->size < pSegment->size) ? pProcess->size : pSegment->size)
+			* (100 - cowWritePercent) / 100;
+		if (share > 0)
+		{
+			pSegment->refs++;
+			pProcess->parentSegment = id;
+			pProcess->ppid = pSegment->holder;
+			pProcess->size -= share;
+			pProcess->sharedSize += share;
+			childCount++;
+		}
+	}
+}
+
+void segmentProcessPlaced(PCB_t* pProcess)
+{
+	unsigned key, id, offset = 0;
+
+	if (!segmentsEnabled()) return;
+	accumulateSaved();
+	logicalUsed += pProcess->size + pProcess->sharedSize;
+	key = keyOf(pProcess);
+	if ((sharedImagePercent > 0) && (imageOf[key] == 0))
+	{	// the first instance of the program holds the image at the start of its block
+		offset = pProcess->size * sharedImagePercent / 100;
+		id = (offset > 0) ? newSegment(segmentImage, key, pProcess->pid, 0, offset) : 0;
+		if (id != 0)
+		{
+			imageOf[key] = id;
+			imageCount++;
+		}
+		else offset = 0;
+	}
+	if ((cowWritePercent > 0) && (parentOf[key] == 0) && (pProcess->size > offset))
+		parentOf[key] = newSegment(segmentPrivate, key, pProcess->pid, offset, pProcess->size - offset);
+	updateSaved();
+}
+
+void segmentProcessReleased(PCB_t* pProcess)
+{
+	unsigned held[2];
+	unsigned heldCount = 0;
+	unsigned key, h, cursor = 0;
+	Segment_t* pSegment;
+
+	if (!segmentsEnabled())
+	{
+		usedMemory -= pProcess->size;
+		releaseMemory(pProcess->start, pProcess->size);
+		return;
+	}
+	accumulateSaved();
+	logicalUsed -= pProcess->size + pProcess->sharedSize;
+	// the segments held in the block, the image comes first
+	key = keyOf(pProcess);
+	if ((imageOf[key] != 0) && (segments[imageOf[key] - 1].holder == pProcess->pid))
+		held[heldCount++] = imageOf[key];
+	if ((parentOf[key] != 0) && (segments[parentOf[key] - 1].holder == pProcess->pid))
+		held[heldCount++] = parentOf[key];
+	for (h = 0; h < heldCount; h++)
+	{
+		pSegment = &segments[held[h] - 1];
+		if (pSegment->refs == 0)
+		{
+			forgetSegment(held[h]);
+			continue;
+		}
+		// still referenced: the segment stays where it is, the rest is freed
+		releaseRange(pProcess->start + cursor, pSegment->offset - cursor);
+		cursor = pSegment->offset + pSegment->size;
+		pSegment->start = pProcess->start + pSegment->offset;
+		pSegment->holder = 0;
+		standaloneCount++;
+		if (pSegment->kind == segmentPrivate) parentOf[key] = 0;	// no children of an ended parent
+	}
+	releaseRange(pProcess->start + cursor, pProcess->size - cursor);
+	if (pProcess->imageSegment != 0) dropReference(pProcess->imageSegment);
+	if (pProcess->parentSegment != 0) dropReference(pProcess->parentSegment);
+	pProcess->imageSegment = 0;
+	pProcess->parentSegment = 0;
+	updateSaved();
+}
+
+Boolean segmentDetachWaiting(void)
+{
+	static PCB_t* detached[MAX_PROCESSES];
+	unsigned count = 0, i;
+	BlockedProcess_t* blocked;
+	PCB_t* pProcess;
+
+	if (!segmentsEnabled() || (runningCount > 0)) return FALSE;
+	for (blocked = blockedQueue; blocked != NULL; blocked = blocked->next)
+		if ((blocked->process->imageSegment != 0) || (blocked->process->parentSegment != 0))
+			detached[count++] = blocked->process;
+	if (count == 0) return FALSE;
+	accumulateSaved();
+	for (i = 0; i < count; i++)
+	{	// the queue is ordered by size, so the process is queued again
+		pProcess = detached[i];
+		removeBlockedProcess(pProcess);
+		if (pProcess->imageSegment != 0) dropReference(pProcess->imageSegment);
+		if (pProcess->parentSegment != 0) dropReference(pProcess->parentSegment);
+		pProcess->imageSegment = 0;
+		pProcess->parentSegment = 0;
+		pProcess->size += pProcess->sharedSize;
+		pProcess->sharedSize = 0;
+		enqueueBlockedProcessWithPriority(pProcess);
+	}
+	updateSaved();
+	logGeneric("Segments: waiting processes detached from their segments");
+	return TRUE;
+}
+
+unsigned segmentCompact(unsigned nextFreeStart[])
+{
+	char buffer[100];
+	unsigned id, node, moved = 0;
+	Segment_t* pSegment;
+
+	for (id = 1; id <= SEGMENT_MAX; id++)
+	{
+		pSegment = &segments[id - 1];
+		if (!pSegment->valid || (pSegment->holder != 0)) continue;
+		node = nodeOf(pSegment->start);
+		if (pSegment->start != nextFreeStart[node])
+		{
+			sprintf(buffer, "Moving segment %u from %u to %u", id, pSegment->start, nextFreeStart[node]);
+			logGeneric(buffer);
+			moved += pSegment->size;
+			logProcessChange(memorySegmentMoved, id, pSegment->start, pSegment->size, nextFreeStart[node]);
+			pSegment->start = nextFreeStart[node];
+		}
+		nextFreeStart[node] += pSegment->size;
+	}
+	return moved;
+}
+
+unsigned logStandaloneSegments(void)
+{
+	unsigned id, total = 0;
+
+	for (id = 1; id <= SEGMENT_MAX; id++)
+	{
+		if (!segments[id - 1].valid || (segments[id - 1].holder != 0)) continue;
+		printf("SEG: %3u | Start: %6u | Size: %6u | Refs: %u\n",
+			id, segments[id - 1].start, segments[id - 1].size, segments[id - 1].refs);
+		total += segments[id - 1].size;
+	}
+	return total;
+}
+
+void saveSegmentCheckpoint(Checkpoint_t* pCheckpoint)
+{
+	memcpy(pCheckpoint->segment.segments, segments, sizeof(segments));
+	memcpy(pCheckpoint->segment.imageOf, imageOf, sizeof(imageOf));
+	memcpy(pCheckpoint->segment.parentOf, parentOf, sizeof(parentOf));
+	pCheckpoint->segment.imageCount = imageCount;
+	pCheckpoint->segment.attachedCount = attachedCount;
+	pCheckpoint->segment.childCount = childCount;
+	pCheckpoint->segment.standaloneCount = standaloneCount;
+	pCheckpoint->segment.logicalUsed = logicalUsed;
+	pCheckpoint->segment.savedNow = savedNow;
+	pCheckpoint->segment.savedPeak = savedPeak;
+	pCheckpoint->segment.savedIntegral = savedIntegral;
+	pCheckpoint->segment.lastSavedChange = lastSavedChange;
+}
+
+void restoreSegmentCheckpoint(const Checkpoint_t* pCheckpoint)
+{
+	memcpy(segments, pCheckpoint->segment.segments, sizeof(segments));
+	memcpy(imageOf, pCheckpoint->segment.imageOf, sizeof(imageOf));
+	memcpy(parentOf, pCheckpoint->segment.parentOf, sizeof(parentOf));
+	imageCount = pCheckpoint->segment.imageCount;
+	attachedCount = pCheckpoint->segment.attachedCount;
+	childCount = pCheckpoint->segment.childCount;
+	standaloneCount = pCheckpoint->segment.standaloneCount;
+	logicalUsed = pCheckpoint->segment.logicalUsed;
+	savedNow = pCheckpoint->segment.savedNow;
+	savedPeak = pCheckpoint->segment.savedPeak;
+	savedIntegral = pCheckpoint->segment.savedIntegral;
+	lastSavedChange = pCheckpoint->segment.lastSavedChange;
+}
+
+void logSegmentStatistics(void)
+{
+	char buffer[200];
+
+	if (!segmentsEnabled()) return;
+	accumulateSaved();
+	sprintf(buffer, "Segments: %u images shared by %u processes, %u copy-on-write children, "
+		"%u segments outlived their holder", imageCount, attachedCount, childCount, standaloneCount);
+	logGeneric(buffer);
+	sprintf(buffer, "Segments: memory saved mean %.1f units, peak %lld units",
+		(systemTime > 0) ? (double)savedIntegral / systemTime : 0.0, savedPeak);
+	logGeneric(buffer);
+}
+
+/* ----------------------------------------------------------------- */
+/*                       Local helper functions                      */
+/* ----------------------------------------------------------------- */
+
+static unsigned keyOf(const PCB_t* pProcess)
+{	// the program: owner and type
+	return (pProcess->ownerID % MAX_OWNERS) * SEGMENT_PROCESS_TYPES + (unsigned)pProcess->type % SEGMENT_PROCESS_TYPES;
+}
+
+static unsigned newSegment(SegmentKind_t kind, unsigned key, pid_t holder, unsigned offset, unsigned size)
+{	// returns the id, 0 if the table is full
+	unsigned id;
+
+	for (id = 1; id <= SEGMENT_MAX; id++)
+	{
+		if (segments[id - 1].valid) continue;
+		segments[id - 1].valid = TRUE;
+		segments[id - 1].kind = kind;
+		segments[id - 1].key = key;
+		segments[id - 1].holder = holder;
+		segments[id - 1].offset = offset;
+		segments[id - 1].start = 0;
+		segments[id - 1].size = size;
+		segments[id - 1].refs = 0;
+		return id;
+	}
+	return 0;
+}
+
+static void forgetSegment(unsigned id)
+{
+	Segment_t* pSegment = &segments[id - 1];
+
+	if (imageOf[pSegment->key] == id) imageOf[pSegment->key] = 0;
+	if (parentOf[pSegment->key] == id) parentOf[pSegment->key] = 0;
+	pSegment->valid = FALSE;
+}
+
+static void dropReference(unsigned id)
+{	// a standalone segment is freed with its last reference
+	Segment_t* pSegment = &segments[id - 1];
+
+	pSegment->refs--;
+	if ((pSegment->refs > 0) || (pSegment->holder != 0)) return;
+	releaseRange(pSegment->start, pSegment->size);
+	forgetSegment(id);
+}
+
+static void releaseRange(unsigned start, unsigned size)
+{
+	if (size == 0) return;
+	usedMemory -= size;
+	releaseMemory(start, size);
+}
+
+static void accumulateSaved(void)
+{
+	savedIntegral += savedNow * (long long)(systemTime - lastSavedChange);
+	lastSavedChange = systemTime;
+}
+
+static void updateSaved(void)
+{
+	savedNow = (long long)logicalUsed - (long long)usedMemory;
+	if (savedNow > savedPeak) savedPeak = savedNow;
+}
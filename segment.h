@@ -0,0 +1,101 @@
+/* Include-file defining shared and copy-on-write memory segments			*/
+/* Processes of the same owner and type run the same program. With shared	*/
+/* images the first sharedImagePercent of a process are its program image,	*/
+/* which is kept in memory once per owner and type: the first process that	*/
+/* gets memory holds the image at the start of its block, later arrivals	*/
+/* reference it and only allocate the rest of their size.					*/
+/* With copy-on-write the trace has no fork information, so a process that	*/
+/* arrives while another process of its owner and type runs is taken as		*/
+/* forked from the first of them (its ppid is set): it shares the private	*/
+/* memory of that parent and only allocates the cowWritePercent of it that	*/
+/* it writes.																*/
+/* Segments are reference counted. A segment lives in the block of its		*/
+/* holder; when the holder ends while the segment is still referenced, the	*/
+/* segment stays allocated on its own until the last reference is dropped.	*/
+/* References are taken on arrival, so a waiting process keeps its			*/
+/* segments in memory. Compaction moves the standalone segments, too.		*/
+/* Should memory hold nothing but standalone segments of waiting processes	*/
+/* while none of them fits, the waiting processes give up their references.	*/
+/* usedMemory counts the physical memory, the saving is reported at the end.*/
+#ifndef __SEGMENT__
+#define __SEGMENT__
+
+#include "globals.h"
+#include "admission.h"
+
+#define SEGMENT_MAX_IMAGE_PERCENT	90		// the rest of a process stays private
+#define SEGMENT_MAX					(2 * MAX_PID)	// held and standalone segments
+#define SEGMENT_PROCESS_TYPES		5		// os ... foreground
+#define SEGMENT_KEYS				(MAX_OWNERS * SEGMENT_PROCESS_TYPES)
+
+/* data type for the kinds of segments */
+typedef enum
+	{
+		segmentImage,		// program image shared by owner and type
+		segmentPrivate		// private memory of a parent shared by its children
+	} SegmentKind_t;
+
+/* data type of a segment */
+typedef struct
+	{
+		Boolean valid;
+		SegmentKind_t kind;
+		unsigned key;				// owner and type, see keyOf() in segment.c
+		pid_t holder;				// process whose block contains it, 0 if standalone
+		unsigned offset;			// position in the block of the holder
+		unsigned start;				// address, only if standalone
+		unsigned size;
+		unsigned refs;				// referencing processes besides the holder
+	} Segment_t;
+
+extern unsigned sharedImagePercent;	// share of a process that is its image, 0 = off
+extern unsigned cowWritePercent;	// share of the parent memory a child writes, 0 = off
+
+
+Boolean segmentsEnabled(void);
+/* returns TRUE if shared images or copy-on-write are switched on			*/
+
+void resetSegments(void);
+/* drops all segments and clears the statistics, called at start of a run	*/
+
+void segmentAttach(PCB_t* pProcess);
+/* called on arrival: references the image of the owner and type and the	*/
+/* memory of a parent, if any, and reduces the size of the process by the	*/
+/* shared units																*/
+
+void segmentProcessPlaced(PCB_t* pProcess);
+/* a process got its block: if its owner and type have no image or no		*/
+/* parent yet, the process becomes their holder								*/
+
+void segmentProcessReleased(PCB_t* pProcess);
+/* frees the memory of a completed process and reduces usedMemory: its		*/
+/* block except the segments still referenced by others, and standalone	*/
+/* segments it was the last to reference. Without segments this is			*/
+/* releaseMemory() of the whole block										*/
+
+Boolean segmentDetachWaiting(void);
+/* called when no process runs: the waiting processes drop their			*/
+/* references and get back their full size, so the segments only they		*/
+/* kept are freed. Returns TRUE if a waiting process was detached			*/
+
+unsigned segmentCompact(unsigned nextFreeStart[]);
+/* moves every standalone segment to nextFreeStart of its node during		*/
+/* compaction and advances it, returns the number of units moved			*/
+
+unsigned logStandaloneSegments(void);
+/* prints the segments that outlived their holder for the memory dump,		*/
+/* returns the units they occupy											*/
+
+struct Checkpoint;
+
+void saveSegmentCheckpoint(struct Checkpoint* pCheckpoint);
+/* stores the segments and the statistics									*/
+
+void restoreSegmentCheckpoint(const struct Checkpoint* pCheckpoint);
+/* restores the segments and the statistics									*/
+
+void logSegmentStatistics(void);
+/* prints the number of shared images and children and the memory saved,	*/
+/* only if segments are enabled												*/
+
+#endif /* __SEGMENT__ */
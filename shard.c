@@ -0,0 +1,463 @@
+/* Implementation of the time-sharded parallel simulation of a trace */
+/* for comments on the functions see the associated .h-file */
+
+/* ---------------------------------------------------------------- */
+/* Include required external definitions */
+#include <limits.h>
+#include <stddef.h>
+#include "globals.h"
+#include "shard.h"
+#include "loader.h"
+#include "checkpoint.h"
+#include "summary.h"
+#ifndef _WIN32
+#define SHARD_FORK
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#endif
+
+/* data type of the first record of a window */
+typedef struct
+	{
+		long long offset;			// trace position of the record
+		unsigned start;				// its arrival, the start time of the window
+		unsigned index;				// records before it, for the pid estimate
+	} ShardCut_t;
+
+/* data type of the state of an empty system, equal keys have equal futures */
+typedef struct
+	{
+		unsigned time;				// system time, or the next arrival if later
+		long long traceOffset;		// behind the next record, -1 at the end
+		unsigned long long stateHash;	// last pid, free list, learned placement
+	} ShardKey_t;
+
+/* data type of an empty instant recorded by a window */
+typedef struct
+	{
+		ShardKey_t key;
+		SummaryPart_t part;			// summary values since the previous instant
+		Boolean runEnded;			// the trace is done
+		Boolean gaveUp;				// no empty instant until giveUpTime, the key is not valid
+		int matched;				// instant of the window reached by a re-simulation, -1 if none
+	} ShardPoint_t;
+
+/* ----------------------------------------------------------------	*/
+/* Declarations of global variables visible only in this file 		*/
+unsigned shardCount = 1;
+
+#ifdef SHARD_FORK
+static Boolean shardActive = FALSE;	// only in the child processes
+static FILE* pointFile;
+static Boolean pointFailed;
+static unsigned stopTime;			// the window ends at the first empty instant from here
+static unsigned giveUpTime;			// or here, if the system does not run empty
+static Checkpoint_t* pScratch;		// for the state hash
+static ShardKey_t* targets;			// instants of the next window, while re-simulating
+static unsigned targetCount;
+static unsigned targetNext;
+static char workDir[CHECKPOINT_PATH_SIZE];
+
+/* ---------------------------------------------------------------- */
+/*                Declarations of local helper functions            */
+static unsigned findCuts(const char* traceFilename, ShardCut_t cuts[], unsigned count);
+static void runWindow(const char* traceFilename, unsigned seed, const ShardCut_t* pCut,
+	unsigned stop, unsigned giveUp, unsigned window);
+static void rerunWindow(const char* startCheckpoint, unsigned stop, unsigned giveUp, unsigned window);
+static void runToStop(unsigned stop, unsigned giveUp, const char* pointName, const char* checkpointName);
+static Boolean waitForChild(pid_t child);
+static void takePoint(ShardPoint_t* pPoint);
+static unsigned long long stateHash(void);
+static unsigned long long hashBytes(unsigned long long hash, const void* pData, size_t size);
+static Boolean sameKey(const ShardKey_t* pKey1, const ShardKey_t* pKey2);
+static int findTarget(const ShardKey_t* pKey);
+static Boolean loadTargets(const char* pointName);
+static int findPoint(const char* pointName, const ShardKey_t* pKey);
+static Boolean addPoints(const char* pointName, int first, SummaryPart_t* pTotal, ShardPoint_t* pLast);
+static void fileName(char* buffer, const char* kind, unsigned window, const char* suffix);
+static void removeFiles(unsigned count);
+#endif
+
+/* ---------------------------------------------------------------- */
+/*                Externally available functions                    */
+/* ---------------------------------------------------------------- */
+
+Boolean runSharded(const char* traceFilename, unsigned seed)
+{
+#ifdef SHARD_FORK
+	static SummaryPart_t total;		// the summary refers to it after the return
+	ShardCut_t cuts[SHARD_MAX];
+	unsigned stops[SHARD_MAX], giveUps[SHARD_MAX];
+	pid_t children[SHARD_MAX];
+	char pointName[CHECKPOINT_PATH_SIZE + 32], checkpointName[CHECKPOINT_PATH_SIZE + 32];
+	ShardPoint_t last;
+	Boolean ok = TRUE;
+	unsigned count, i, joined = 0, converged = 0, rerun = 0, continued = 0;
+	pid_t child;
+	int j;
+	char line[200];
+
+	if (strcmp(traceFilename, "-") == 0)
+	{
+		fprintf(stderr, "A sharded run needs a trace file\n");
+		return FALSE;
+	}
+	count = findCuts(traceFilename, cuts, shardCount);
+	if (count == 0)
+	{
+		fprintf(stderr, "Cannot open trace %s\n", traceFilename);
+		return FALSE;
+	}
+	sprintf(workDir, "%.*s/memsim-shards-XXXXXX", CHECKPOINT_PATH_SIZE - 32,
+		(getenv("TMPDIR") != NULL) ? getenv("TMPDIR") : "/tmp");
+	if (mkdtemp(workDir) == NULL)
+	{
+		fprintf(stderr, "Cannot create a directory for the windows\n");
+		return FALSE;
+	}
+	for (i = 0; i < count; i++)
+	{	// a window may overrun its stop by its own length to find an empty
+		// instant, so a trace that never runs empty costs each window at
+		// most twice its share instead of the rest of the trace
+		stops[i] = (i + 1 < count) ? cuts[i + 1].start : UINT_MAX;
+		giveUps[i] = (stops[i] > UINT_MAX - (stops[i] - cuts[i].start))
+			? UINT_MAX : stops[i] + (stops[i] - cuts[i].start);
+	}
+	fflush(stdout);					// the children must not write it again
+	fflush(stderr);
+	for (i = 0; i < count; i++)
+	{	// all windows at the same time, from their estimated start states
+		children[i] = fork();
+		if (children[i] == 0) runWindow(traceFilename, seed, &cuts[i], stops[i], giveUps[i], i);
+		if (children[i] < 0) ok = FALSE;
+	}
+	for (i = 0; i < count; i++)
+		if ((children[i] > 0) && !waitForChild(children[i])) ok = FALSE;
+
+	// join the windows in order, starting from the first one, which is exact
+	memset(&total, 0, sizeof(total));
+	fileName(pointName, "window", 0, "points");
+	fileName(checkpointName, "window", 0, "ckpt");
+	if (ok) ok = addPoints(pointName, 0, &total, &last);
+	for (i = 1; ok && (i < count) && !last.runEnded; i++)
+	{
+		fileName(pointName, "window", i, "points");
+		j = last.gaveUp ? -1 : findPoint(pointName, &last.key);
+		if (last.gaveUp)
+		{	// the previous window stopped in a busy system, its end state is true
+			sprintf(line, "Shards: no empty instant at the end of window %u, window %u continues from there",
+				i - 1, i);
+			logGeneric(line);
+			continued++;
+		}
+		if (j >= 0)
+		{	// the window started from the true state, or reached it later
+			ok = addPoints(pointName, j + 1, &total, &last);
+			fileName(checkpointName, "window", i, "ckpt");
+			joined++;
+			continue;
+		}
+		fflush(stdout);
+		fflush(stderr);
+		child = fork();
+		if (child == 0) rerunWindow(checkpointName, stops[i], giveUps[i], i);
+		ok = (child > 0) && waitForChild(child);
+		fileName(pointName, "rerun", i, "points");
+		if (ok) ok = addPoints(pointName, 0, &total, &last);
+		if (ok && (last.matched >= 0))
+		{	// the rest of the window is valid as simulated
+			fileName(pointName, "window", i, "points");
+			ok = addPoints(pointName, last.matched + 1, &total, &last);
+			fileName(checkpointName, "window", i, "ckpt");
+			converged++;
+		}
+		else
+		{
+			fileName(checkpointName, "rerun", i, "ckpt");
+			rerun++;
+		}
+	}
+	removeFiles(count);
+	if (!ok)
+	{
+		fprintf(stderr, "A window of the sharded run failed\n");
+		return FALSE;
+	}
+	simSeed = seed;
+	setSummaryTotal(&total);
+	sprintf(line, "Shards: %u windows, %u joined as simulated, %u after re-simulation, %u re-simulated, "
+		"%u continued without an empty instant", count, joined, converged, rerun, continued);
+	logGeneric(line);
+	return TRUE;
+#else
+	(void)traceFilename;
+	(void)seed;
+	fprintf(stderr, "Sharded runs are not available on this system\n");
+	return FALSE;
+#endif
+}
+
+Boolean shardService(void)
+{
+#ifdef SHARD_FORK
+	ShardPoint_t point;
+
+	if (!shardActive) return FALSE;
+	if ((runningCount > 0) || (blockedQueue != NULL))
+	{
+		if (systemTime < giveUpTime) return FALSE;
+		// the end state is stored as it is, only the summary values count
+		memset(&point, 0, sizeof(point));
+		takeSummaryPart(&point.part);
+		point.gaveUp = TRUE;
+		point.matched = -1;
+		if (fwrite(&point, sizeof(point), 1, pointFile) != 1) pointFailed = TRUE;
+		return TRUE;
+	}
+	takePoint(&point);
+	point.matched = findTarget(&point.key);
+	if (fwrite(&point, sizeof(point), 1, pointFile) != 1) pointFailed = TRUE;
+	return point.runEnded || (point.matched >= 0) || (point.key.time >= stopTime);
+#else
+	return FALSE;
+#endif
+}
+
+/* ----------------------------------------------------------------- */
+/*                       Local helper functions                      */
+/* ----------------------------------------------------------------- */
+
+#ifdef SHARD_FORK
+static unsigned findCuts(const char* traceFilename, ShardCut_t cuts[], unsigned count)
+{	// the first records of the windows: cut at about equal trace lengths,
+	// only where the arrival time changes, returns the number of windows
+	char line[129];
+	PCB_t record;
+	FILE* trace;
+	long long dataStart, size, offset;
+	unsigned windows = 1, index = 0, previousStart = 0;
+
+	trace = openConfigFile(NULL, traceFilename);
+	if (trace == NULL) return 0;
+	dataStart = ftell(trace);
+	fseek(trace, 0, SEEK_END);
+	size = ftell(trace) - dataStart;
+	fseek(trace, dataStart, SEEK_SET);
+	cuts[0].offset = dataStart;		// the first window starts like a sequential run
+	cuts[0].start = 0;
+	cuts[0].index = 0;
+	for (;;)
+	{	// read like readNextProcess()
+		offset = ftell(trace);
+		line[0] = '\0';
+		if ((fgets(line, 128, trace) == NULL) || (line[0] == '\0')) break;
+		parseProcessRecord(line, &record);
+		if ((windows < count) && (index > 0) && (record.start > previousStart)
+			&& (offset - dataStart >= size * windows / count))
+		{
+			cuts[windows].offset = offset;
+			cuts[windows].start = record.start;
+			cuts[windows].index = index;
+			windows++;
+		}
+		previousStart = record.start;
+		index++;
+	}
+	fclose(trace);
+	return windows;
+}
+
+static void runWindow(const char* traceFilename, unsigned seed, const ShardCut_t* pCut,
+	unsigned stop, unsigned giveUp, unsigned window)
+{	// child: simulates a window from its estimated start state, does not return
+	char pointName[CHECKPOINT_PATH_SIZE + 32], checkpointName[CHECKPOINT_PATH_SIZE + 32];
+
+	logLevel = LOG_LEVEL_OFF;
+	setCheckpointOptions(traceFilename, NULL, 0);
+	systemTime = pCut->start;		// like initSim(), but at the first arrival of the window
+	batchComplete = FALSE;
+	candidateProcess.valid = FALSE;
+	processFile = openConfigFile(processFile, traceFilename);
+	if ((processFile == NULL) || (fseek(processFile, pCut->offset, SEEK_SET) != 0)) _exit(EXIT_FAILURE);
+	simSeed = seed;
+	srand(seed);
+	initOS();
+	// every record before took one pid, 1 ... MAX_PID-1 in turn
+	setLastPid((pCut->index == 0) ? 0 : (pCut->index - 1) % (MAX_PID - 1) + 1);
+	fileName(pointName, "window", window, "points");
+	fileName(checkpointName, "window", window, "ckpt");
+	runToStop(stop, giveUp, pointName, checkpointName);
+}
+
+static void rerunWindow(const char* startCheckpoint, unsigned stop, unsigned giveUp, unsigned window)
+{	// child: simulates a window again from the true end state of the previous
+	// one until it reaches an empty instant of the window, does not return
+	char pointName[CHECKPOINT_PATH_SIZE + 32], checkpointName[CHECKPOINT_PATH_SIZE + 32];
+
+	logLevel = LOG_LEVEL_OFF;
+	if (!restoreCheckpoint(startCheckpoint)) _exit(EXIT_FAILURE);
+	fileName(pointName, "window", window, "points");
+	if (!loadTargets(pointName)) _exit(EXIT_FAILURE);
+	fileName(pointName, "rerun", window, "points");
+	fileName(checkpointName, "rerun", window, "ckpt");
+	runToStop(stop, giveUp, pointName, checkpointName);
+}
+
+static void runToStop(unsigned stop, unsigned giveUp, const char* pointName, const char* checkpointName)
+{	// child: runs the core loop until the window is done, stores the
+	// recorded instants and the end state, does not return
+	SummaryPart_t before;
+	Boolean ok;
+
+	pointFile = fopen(pointName, "wb");
+	pScratch = (Checkpoint_t*)calloc(1, sizeof(Checkpoint_t));
+	if ((pointFile == NULL) || (pScratch == NULL)) _exit(EXIT_FAILURE);
+	pointFailed = FALSE;
+	stopTime = stop;
+	giveUpTime = giveUp;
+	takeSummaryPart(&before);		// after a restore: the run before the window
+	shardActive = TRUE;
+	if (!shardService()) resumeCoreLoop();	// the start is an empty instant, too
+	shardActive = FALSE;
+	ok = !pointFailed && (fclose(pointFile) == 0) && writeCheckpoint(checkpointName);
+	_exit(ok ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+static Boolean waitForChild(pid_t child)
+{
+	int status;
+
+	if (waitpid(child, &status, 0) != child) return FALSE;
+	return WIFEXITED(status) && (WEXITSTATUS(status) == EXIT_SUCCESS);
+}
+
+static void takePoint(ShardPoint_t* pPoint)
+{	// the state of the empty system and the summary values since the last point
+	checkForProcessInBatch();		// the key includes the next record
+	pPoint->key.time = (candidateProcess.valid && (candidateProcess.start > systemTime))
+		? candidateProcess.start : systemTime;
+	pPoint->key.traceOffset = candidateProcess.valid ? loaderOffset() : -1;
+	pPoint->key.stateHash = stateHash();
+	takeSummaryPart(&pPoint->part);
+	pPoint->runEnded = !candidateProcess.valid && batchComplete;
+	pPoint->gaveUp = FALSE;
+	pPoint->matched = -1;
+}
+
+static unsigned long long stateHash(void)
+{	// FNV-1a of the state that outlives an empty system
+	unsigned long long hash = 14695981039346656037ULL;
+
+	saveCoreCheckpoint(pScratch);
+	saveQuickFitCheckpoint(pScratch);
+	saveNumaCheckpoint(pScratch);
+	hash = hashBytes(hash, &pScratch->core.pidCounter, sizeof(pScratch->core.pidCounter));
+	hash = hashBytes(hash, pScratch->core.freeBlocks, pScratch->core.freeBlockCount * sizeof(CheckpointBlock_t));
+	hash = hashBytes(hash, &pScratch->numa.interleaveNext, sizeof(pScratch->numa.interleaveNext));
+	if (quickFitEnabled)	// the learned state, not the counters
+		hash = hashBytes(hash, &pScratch->quickFit, offsetof(Checkpoint_t, quickFit.hits) - offsetof(Checkpoint_t, quickFit));
+	return hash;
+}
+
+static unsigned long long hashBytes(unsigned long long hash, const void* pData, size_t size)
+{
+	const unsigned char* pByte = (const unsigned char*)pData;
+
+	while (size-- > 0)
+	{
+		hash ^= *pByte++;
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+static Boolean sameKey(const ShardKey_t* pKey1, const ShardKey_t* pKey2)
+{
+	return (pKey1->time == pKey2->time) && (pKey1->traceOffset == pKey2->traceOffset)
+		&& (pKey1->stateHash == pKey2->stateHash);
+}
+
+static int findTarget(const ShardKey_t* pKey)
+{	// the targets are in time order, so are the calls
+	unsigned i;
+
+	while ((targetNext < targetCount) && (targets[targetNext].time < pKey->time)) targetNext++;
+	for (i = targetNext; (i < targetCount) && (targets[i].time == pKey->time); i++)
+		if (sameKey(&targets[i], pKey)) return (int)i;
+	return -1;
+}
+
+static Boolean loadTargets(const char* pointName)
+{
+	ShardPoint_t point;
+	FILE* f = fopen(pointName, "rb");
+
+	if (f == NULL) return FALSE;
+	targetCount = 0;
+	targetNext = 0;
+	while ((fread(&point, sizeof(point), 1, f) == 1) && !point.gaveUp)
+	{	// a point without a key can only be the last one
+		if ((targetCount & (targetCount - 1)) == 0)	// grow at powers of two
+			targets = (ShardKey_t*)realloc(targets, (targetCount ? 2 * targetCount : 1) * sizeof(ShardKey_t));
+		if (targets == NULL) break;
+		targets[targetCount++] = point.key;
+	}
+	fclose(f);
+	return targets != NULL;
+}
+
+static int findPoint(const char* pointName, const ShardKey_t* pKey)
+{	// the index of the instant with the key, -1 if none
+	ShardPoint_t point;
+	FILE* f = fopen(pointName, "rb");
+	int index, found = -1;
+
+	if (f == NULL) return -1;
+	for (index = 0; (found < 0) && (fread(&point, sizeof(point), 1, f) == 1); index++)
+		if (!point.gaveUp && sameKey(&point.key, pKey)) found = index;
+	fclose(f);
+	return found;
+}
+
+static Boolean addPoints(const char* pointName, int first, SummaryPart_t* pTotal, ShardPoint_t* pLast)
+{	// adds the summary values from instant first on, *pLast is the last one
+	ShardPoint_t point;
+	FILE* f = fopen(pointName, "rb");
+	int index;
+
+	if (f == NULL) return FALSE;
+	for (index = 0; fread(&point, sizeof(point), 1, f) == 1; index++)
+	{
+		if (index >= first) addSummaryPart(pTotal, &point.part);
+		*pLast = point;
+	}
+	fclose(f);
+	return index > 0;
+}
+
+static void fileName(char* buffer, const char* kind, unsigned window, const char* suffix)
+{
+	sprintf(buffer, "%s/%s-%u.%s", workDir, kind, window, suffix);
+}
+
+static void removeFiles(unsigned count)
+{
+	char name[CHECKPOINT_PATH_SIZE + 32];
+	unsigned i;
+
+	for (i = 0; i < count; i++)
+	{	// not every file exists
+		fileName(name, "window", i, "points");
+		remove(name);
+		fileName(name, "window", i, "ckpt");
+		remove(name);
+		fileName(name, "rerun", i, "points");
+		remove(name);
+		fileName(name, "rerun", i, "ckpt");
+		remove(name);
+	}
+	rmdir(workDir);
+}
+#endif
@@ -0,0 +1,43 @@
+/* Include-file defining the time-sharded parallel simulation of a trace		*/
+/* The trace is cut into shardCount windows of about the same length, at	*/
+/* arrival times that no two records share. Every window is simulated by a	*/
+/* child process of its own, all at the same time, from an estimated start	*/
+/* state: an empty system at the first arrival of the window, with the		*/
+/* pids handed out as if no pid had ever been skipped.						*/
+/* Whenever a run has neither running nor waiting processes, its future		*/
+/* only depends on the next record of the trace, the last pid, the free		*/
+/* list and the learned placement state. The children record these empty	*/
+/* instants together with the summary values since the previous one. A		*/
+/* window ends at its first empty instant after the start of the next one,	*/
+/* or one window length later in a busy system: the next window is then		*/
+/* simulated again from that end state, so a trace that never runs empty	*/
+/* costs each window at most twice its share and is logged.					*/
+/* The windows are then joined in order: where the true end state of the	*/
+/* previous window is among the empty instants of the next, the rest of		*/
+/* that window is valid as simulated. Otherwise the window is simulated		*/
+/* again from the true state (a checkpoint) until it reaches one of them	*/
+/* or its end. The joined summary is identical to the sequential run.		*/
+/* The children share nothing but files, so the module state of the			*/
+/* simulator needs no change. Only available on POSIX systems.				*/
+#ifndef __SHARD__
+#define __SHARD__
+
+#include "bs_types.h"
+
+#define SHARD_MAX	64				// windows of a sharded run
+
+extern unsigned shardCount;		// windows simulated in parallel, 1 = sequential
+
+
+Boolean runSharded(const char* traceFilename, unsigned seed);
+/* simulates the trace in shardCount windows and joins them; the summary	*/
+/* then reports the joined run (see setSummaryTotal()). Log output of the	*/
+/* windows is off. Returns FALSE if the trace or the temporary files		*/
+/* cannot be used or a window fails											*/
+
+Boolean shardService(void);
+/* called between two iterations of the core loop: records an empty			*/
+/* instant in a window of a sharded run. Returns TRUE when the window is	*/
+/* done and the core loop has to stop										*/
+
+#endif /* __SHARD__ */
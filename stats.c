@@ -0,0 +1,226 @@
+/* Implementation of the live memory statistics */
+/* for comments on the functions see the associated .h-file */
+
+/* ---------------------------------------------------------------- */
+/* Include required external definitions */
+#include "globals.h"
+#include "stats.h"
+#include "checkpoint.h"
+#include "quickfit.h"
+
+/* ----------------------------------------------------------------	*/
+/* Declarations of global variables visible only in this file 		*/
+
+// number of free blocks per size, sizes of MEMORY_SIZE and above share the
+// last entry. The largest free block is the highest non-empty entry, so it
+// only has to be searched downwards when the last block of that size goes.
+static unsigned blocksBySize[MEMORY_SIZE + 1];
+static unsigned largestFree;		// highest size with blocksBySize[] > 0, at least; see settleLargestFree()
+static unsigned freeBlocks;			// number of blocks in the free list
+static unsigned totalFree;			// free memory units in the free list
+static unsigned long long allocations;	// allocation attempts
+static unsigned long long failures;	// failed allocation attempts
+static unsigned compactions;		// compaction runs
+static unsigned long long unitsMoved;	// memory units moved by compaction
+static unsigned blockedCount;		// length of the blocked queue
+static unsigned long long usedIntegral;	// sum of usedMemory * elapsed time
+static unsigned lastUsedChange;		// systemTime up to which usedIntegral is summed up
+
+static FILE* statsFile = NULL;		// output of the periodic snapshots
+static unsigned statsInterval = 0;	// time between two snapshots, 0 = disabled
+static unsigned nextSnapshot = 0;	// systemTime of the next due snapshot
+
+/* ---------------------------------------------------------------- */
+/*                Declarations of local helper functions            */
+static void writeSnapshot(unsigned time);
+static void settleLargestFree(void);
+
+/* ---------------------------------------------------------------- */
+/*                Externally available functions                    */
+/* ---------------------------------------------------------------- */
+
+void resetStats(void)
+{
+	memset(blocksBySize, 0, sizeof(blocksBySize));
+	largestFree = 0;
+	freeBlocks = 0;
+	totalFree = 0;
+	allocations = 0;
+	failures = 0;
+	compactions = 0;
+	unitsMoved = 0;
+	blockedCount = 0;
+	usedIntegral = 0;
+	lastUsedChange = systemTime;
+	nextSnapshot = systemTime;
+}
+
+void statsBlockAdded(unsigned size)
+{
+	unsigned index = (size < MEMORY_SIZE) ? size : MEMORY_SIZE;
+
+	blocksBySize[index]++;
+	if (index > largestFree) largestFree = index;
+	freeBlocks++;
+	totalFree += size;
+}
+
+void statsBlockRemoved(unsigned size)
+{
+	unsigned index = (size < MEMORY_SIZE) ? size : MEMORY_SIZE;
+
+	blocksBySize[index]--;		// largestFree is lowered when it is read
+	freeBlocks--;
+	totalFree -= size;
+}
+
+void statsAllocation(Boolean success)
+{
+	allocations++;
+	if (!success) failures++;
+}
+
+void statsCompaction(unsigned movedUnits)
+{
+	compactions++;
+	unitsMoved += movedUnits;
+}
+
+void statsBlockedEnqueued(void)
+{
+	blockedCount++;
+}
+
+void statsBlockedDequeued(void)
+{
+	blockedCount--;
+}
+
+void statsUsedMemoryChanging(void)
+{
+	usedIntegral += (unsigned long long)usedMemory * (systemTime - lastUsedChange);
+	lastUsedChange = systemTime;
+}
+
+unsigned statsLargestFreeBlock(void)
+{
+	settleLargestFree();
+	return largestFree;
+}
+
+unsigned statsFragmentation(void)
+{
+	if (totalFree == 0) return 0;
+	settleLargestFree();
+	return (unsigned)((totalFree - largestFree) * 1000ULL / totalFree);
+}
+
+void getStats(MemoryStats_t* pStats)
+{
+	unsigned long long integral;
+
+	statsUsedMemoryChanging();
+	integral = usedIntegral;
+	pStats->time = systemTime;
+	pStats->usedMemory = usedMemory;
+	pStats->totalFree = totalFree;
+	pStats->freeBlocks = freeBlocks;
+	settleLargestFree();
+	pStats->largestFree = largestFree;
+	pStats->fragmentation = statsFragmentation();
+	pStats->allocations = allocations;
+	pStats->failures = failures;
+	pStats->compactions = compactions;
+	pStats->unitsMoved = unitsMoved;
+	pStats->blocked = blockedCount;
+	pStats->running = runningCount;
+	pStats->utilization = (systemTime > 0)
+		? (double)integral / ((double)systemTime * (double)MEMORY_SIZE) : 0.0;
+}
+
+void saveStatsCheckpoint(Checkpoint_t* pCheckpoint)
+{
+	pCheckpoint->stats.allocations = allocations;
+	pCheckpoint->stats.failures = failures;
+	pCheckpoint->stats.compactions = compactions;
+	pCheckpoint->stats.unitsMoved = unitsMoved;
+	pCheckpoint->stats.blockedCount = blockedCount;
+	pCheckpoint->stats.usedIntegral = usedIntegral;
+	pCheckpoint->stats.lastUsedChange = lastUsedChange;
+	pCheckpoint->stats.nextSnapshot = nextSnapshot;
+}
+
+void restoreStatsCheckpoint(const Checkpoint_t* pCheckpoint)
+{
+	FreeBlock_t* block;
+
+	resetStats();
+	for (block = freeList; block != NULL; block = block->next) statsBlockAdded(block->size);
+	quickFitCountCached();		// restored before the statistics
+	allocations = pCheckpoint->stats.allocations;
+	failures = pCheckpoint->stats.failures;
+	compactions = pCheckpoint->stats.compactions;
+	unitsMoved = pCheckpoint->stats.unitsMoved;
+	blockedCount = pCheckpoint->stats.blockedCount;
+	usedIntegral = pCheckpoint->stats.usedIntegral;
+	lastUsedChange = pCheckpoint->stats.lastUsedChange;
+	nextSnapshot = pCheckpoint->stats.nextSnapshot;
+}
+
+Boolean openStatsOutput(const char* filename, unsigned interval)
+{
+	if (strcmp(filename, "-") == 0) statsFile = stdout;
+	else statsFile = fopen(filename, "w");
+	if (statsFile == NULL) return FALSE;
+	statsInterval = interval;
+	fprintf(statsFile, "time,used,free,free_blocks,largest_free,fragmentation_permille,"
+		"allocations,failures,failure_rate,compactions,units_moved,blocked,running,utilization\n");
+	return TRUE;
+}
+
+void statsPeriodicSnapshot(void)
+{
+	if ((statsInterval == 0) || (systemTime < nextSnapshot)) return;
+	// one line per interval boundary passed, all showing the current state,
+	// as nothing is known about the state in between
+	while (nextSnapshot <= systemTime)
+	{
+		writeSnapshot(nextSnapshot);
+		nextSnapshot += statsInterval;
+		if (nextSnapshot < statsInterval) break;	// overflow of the time range
+	}
+}
+
+void closeStatsOutput(void)
+{
+	if (statsFile == NULL) return;
+	writeSnapshot(systemTime);
+	if (statsFile != stdout) fclose(statsFile);
+	else fflush(statsFile);
+	statsFile = NULL;
+	statsInterval = 0;
+}
+
+/* ----------------------------------------------------------------- */
+/*                       Local helper functions                      */
+/* ----------------------------------------------------------------- */
+
+static void writeSnapshot(unsigned time)
+{
+	MemoryStats_t s;
+
+	if (statsFile == NULL) return;
+	getStats(&s);
+	fprintf(statsFile, "%u,%u,%u,%u,%u,%u,%llu,%llu,%.4f,%u,%llu,%u,%u,%.4f\n",
+		time, s.usedMemory, s.totalFree, s.freeBlocks, s.largestFree, s.fragmentation,
+		s.allocations, s.failures,
+		(s.allocations > 0) ? (double)s.failures / (double)s.allocations : 0.0,
+		s.compactions, s.unitsMoved, s.blocked, s.running, s.utilization);
+}
+
+static void settleLargestFree(void)
+{	// largestFree is lowered lazily, on a read: a split removes the old block
+	// before it adds the rest, so lowering it on the removal would scan down
+	// to a size that the rest raises again right after
+	while ((largestFree > 0) && (blocksBySize[largestFree] == 0)) largestFree--;
+}
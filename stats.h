@@ -0,0 +1,90 @@
+/* Include-file defining the live memory statistics of the simulation		*/
+/* All values are maintained incrementally by the allocator functions		*/
+/* (findFreeBlock(), freeMemory(), compaction, blocked queue), so reading	*/
+/* them never walks the free list or the process table. The size of the		*/
+/* largest free block is settled on a read, which scans the sizes down		*/
+/* from the last known largest block: O(MEMORY_SIZE) in the worst case,		*/
+/* O(1) while it is unchanged since the last read.							*/
+/* Snapshots can be written periodically as CSV lines.						*/
+#ifndef __STATS__
+#define __STATS__
+
+#include <stdio.h>
+#include "bs_types.h"
+
+/* data type of one statistics snapshot */
+typedef struct
+	{
+		unsigned time;					// systemTime of the snapshot
+		unsigned usedMemory;			// allocated memory units
+		unsigned totalFree;				// free memory units, free list and quick-fit caches
+		unsigned freeBlocks;			// number of free blocks, cached ones included
+		unsigned largestFree;			// size of the largest free block
+		unsigned fragmentation;			// external fragmentation in permille:
+										// share of free memory outside the largest block
+		unsigned long long allocations;	// allocation attempts
+		unsigned long long failures;	// allocation attempts without a suitable block
+		unsigned compactions;			// compaction runs
+		unsigned long long unitsMoved;	// memory units moved by compaction
+		unsigned blocked;				// length of the blocked queue
+		unsigned running;				// running processes
+		double utilization;				// time weighted memory utilization since start
+	} MemoryStats_t;
+
+
+void resetStats(void);
+/* clears all statistics, called at start of a run, the free list must be	*/
+/* empty at that point														*/
+
+void statsBlockAdded(unsigned size);
+/* a free block of the given size was added to the free list				*/
+
+void statsBlockRemoved(unsigned size);
+/* a free block of the given size was removed from the free list			*/
+
+void statsAllocation(Boolean success);
+/* records one allocation attempt and whether a block was found				*/
+
+void statsCompaction(unsigned movedUnits);
+/* records one compaction run and the number of memory units it moved		*/
+
+void statsBlockedEnqueued(void);
+void statsBlockedDequeued(void);
+/* a process was added to or removed from the blocked queue					*/
+
+void statsUsedMemoryChanging(void);
+/* accumulates the memory utilization up to the current systemTime, must	*/
+/* be called before usedMemory is changed									*/
+
+unsigned statsLargestFreeBlock(void);
+/* returns the size of the largest free block, see the cost above			*/
+
+unsigned statsFragmentation(void);
+/* returns the external fragmentation in permille, see the cost above		*/
+
+void getStats(MemoryStats_t* pStats);
+/* fills pStats with a snapshot of the current statistics; accumulates		*/
+/* the utilization up to the current systemTime like						*/
+/* statsUsedMemoryChanging() and settles the largest free block				*/
+
+struct Checkpoint;
+
+void saveStatsCheckpoint(struct Checkpoint* pCheckpoint);
+/* stores the counters, the free block values are derived from the free list */
+
+void restoreStatsCheckpoint(const struct Checkpoint* pCheckpoint);
+/* restores the counters and rebuilds the free block values from the		*/
+/* free list, which must be restored before								*/
+
+Boolean openStatsOutput(const char* filename, unsigned interval);
+/* enables periodic snapshots every <interval> time units, written as CSV	*/
+/* to the given file ("-" for stdout). Returns FALSE if it cannot be opened	*/
+
+void statsPeriodicSnapshot(void);
+/* writes all snapshots that are due up to the current systemTime, cheap	*/
+/* if periodic snapshots are disabled or none is due						*/
+
+void closeStatsOutput(void);
+/* writes a final snapshot and closes the snapshot output					*/
+
+#endif /* __STATS__ */
@@ -0,0 +1,259 @@
+/* Implementation of the live ingest of a trace and the wall-clock pacing */
+/* for comments on the functions see the associated .h-file */
+
+/* ---------------------------------------------------------------- */
+/* Include required external definitions */
+#include "globals.h"
+#include "stream.h"
+#include "loader.h"
+#ifndef _WIN32
+#define STREAM_LIVE
+#include <time.h>
+#include <errno.h>
+#include <signal.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+/* ----------------------------------------------------------------	*/
+/* Declarations of global variables visible only in this file 		*/
+Boolean followInput = FALSE;
+double paceFactor = 0.0;
+
+#ifdef STREAM_LIVE
+static int streamFd = -1;
+static char buffer[STREAM_BUFFER_SIZE];	// bytes read, not yet parsed
+static unsigned buffered;
+static Boolean headerSkipped;
+static Boolean inputClosed;				// EOF seen since the last record
+static volatile sig_atomic_t stopRequested;
+
+static Boolean paceStarted = FALSE;		// the clocks are related at the first wait
+static double wallBase;					// wall-clock time in ns ...
+static unsigned simBase;				// ... at this system time
+static unsigned long long recordsRead;
+static unsigned long long lateCount;	// events reached after their wall-clock time
+static double maxLagNs;
+
+/* ---------------------------------------------------------------- */
+/*                Declarations of local helper functions            */
+static void requestStop(int signalNumber);
+static Boolean fillBuffer(int timeoutMs);
+static char* completeLine(void);
+static void dropLine(char* lineEnd);
+static double wallOf(unsigned time);
+static unsigned simOf(double ns);
+#endif
+
+/* ---------------------------------------------------------------- */
+/*                Externally available functions                    */
+/* ---------------------------------------------------------------- */
+
+Boolean openStream(const char* filename)
+{
+#ifdef STREAM_LIVE
+	struct sigaction action;
+
+	// a FIFO blocks here until the writer opens it
+	streamFd = (strcmp(filename, "-") == 0) ? STDIN_FILENO : open(filename, O_RDONLY);
+	if (streamFd < 0)
+	{
+		fprintf(stderr, "Cannot open the feed %s\n", filename);
+		return FALSE;
+	}
+	buffered = 0;
+	headerSkipped = FALSE;
+	inputClosed = FALSE;
+	stopRequested = 0;
+	recordsRead = 0;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = requestStop;	// no SA_RESTART, so a wait returns at once
+	sigemptyset(&action.sa_mask);
+	sigaction(SIGINT, &action, NULL);
+	sigaction(SIGTERM, &action, NULL);
+	logGeneric("Sim: Following the feed, SIGINT or SIGTERM ends it");
+	return TRUE;
+#else
+	(void)filename;
+	fprintf(stderr, "Following a feed is not available on this system\n");
+	return FALSE;
+#endif
+}
+
+Boolean streamReadProcess(PCB_t* pProcess)
+{
+#ifdef STREAM_LIVE
+	char* lineEnd;
+
+	if (stopRequested) return FALSE;
+	fillBuffer(0);
+	while ((lineEnd = completeLine()) != NULL)
+	{
+		*lineEnd = '\0';
+		if (!headerSkipped || (strspn(buffer, " \t\r") == strlen(buffer)))
+		{	// the header and empty lines hold no record
+			headerSkipped = TRUE;
+			dropLine(lineEnd);
+			continue;
+		}
+		parseProcessRecord(buffer, pProcess);
+		dropLine(lineEnd);
+		recordsRead++;
+		return TRUE;
+	}
+#else
+	(void)pProcess;
+#endif
+	return FALSE;
+}
+
+Boolean streamFinished(void)
+{
+#ifdef STREAM_LIVE
+	return stopRequested != 0;
+#else
+	return TRUE;
+#endif
+}
+
+unsigned streamWait(unsigned delta, SchedulingEvent_t* pEvent)
+{
+#ifdef STREAM_LIVE
+	Boolean idle = (*pEvent == none);	// nothing happens without a new record
+	Boolean watchInput;
+	double target, now, remaining;
+	unsigned elapsed;
+
+	if (!followInput && (paceFactor <= 0.0)) return delta;
+	// a new record matters only if there is no candidate that comes first
+	watchInput = followInput && !candidateProcess.valid && !stopRequested;
+	if (paceFactor <= 0.0)
+	{	// unpaced: run ahead as fast as possible, wait only when idle
+		if (idle && watchInput) fillBuffer(STREAM_POLL_MS);
+		return delta;
+	}
+	if (!paceStarted)
+	{
+		wallBase = nowNs();
+		simBase = systemTime;
+		paceStarted = TRUE;
+	}
+	target = idle ? 0.0 : wallOf(systemTime + delta);
+	for (;;)
+	{
+		now = nowNs();
+		if (!idle && (now >= target))
+		{
+			if (now - target > 1e6) lateCount++;	// behind by more than a millisecond
+			if (now - target > maxLagNs) maxLagNs = now - target;
+			return delta;
+		}
+		if (idle && !watchInput) return 0;
+		remaining = idle ? STREAM_POLL_MS * 1e6 : target - now;
+		if (remaining > STREAM_POLL_MS * 1e6) remaining = STREAM_POLL_MS * 1e6;
+		if (watchInput)
+		{
+			if (fillBuffer((int)(remaining / 1e6) + 1))
+			{	// the record is taken at the current paced time
+				elapsed = simOf(nowNs()) - systemTime;
+				if (!idle && (elapsed >= delta)) return delta;
+				*pEvent = none;
+				return elapsed;
+			}
+			if (stopRequested) watchInput = FALSE;
+		}
+		else
+		{
+			struct timespec pause;
+			pause.tv_sec = (time_t)(remaining / 1e9);
+			pause.tv_nsec = (long)(remaining - (double)pause.tv_sec * 1e9);
+			nanosleep(&pause, NULL);
+		}
+	}
+#else
+	(void)pEvent;
+	return delta;
+#endif
+}
+
+void logStreamStatistics(void)
+{
+#ifdef STREAM_LIVE
+	char line[200];
+
+	if (followInput)
+	{
+		sprintf(line, "Stream: %llu records taken from the feed", recordsRead);
+		logGeneric(line);
+	}
+	if (paceFactor > 0.0)
+	{
+		sprintf(line, "Stream: paced at %.2f x %u units per second, %llu events late, max lag %.1f ms",
+			paceFactor, STREAM_UNITS_PER_SECOND, lateCount, maxLagNs / 1e6);
+		logGeneric(line);
+	}
+#endif
+}
+
+/* ----------------------------------------------------------------- */
+/*                       Local helper functions                      */
+/* ----------------------------------------------------------------- */
+
+#ifdef STREAM_LIVE
+static void requestStop(int signalNumber)
+{
+	(void)signalNumber;
+	stopRequested = 1;
+}
+
+static Boolean fillBuffer(int timeoutMs)
+{	// reads what the feed has, waiting up to timeoutMs for it,
+	// returns TRUE if a complete line is buffered
+	struct pollfd fds;
+	struct timespec pause;
+	ssize_t count;
+
+	if (completeLine() != NULL) return TRUE;
+	if (buffered == STREAM_BUFFER_SIZE - 1) buffered = 0;	// an overlong line is dropped
+	if (inputClosed && (timeoutMs > 0))
+	{	// after EOF poll() returns at once, so the time is slept instead
+		pause.tv_sec = timeoutMs / 1000;
+		pause.tv_nsec = (long)(timeoutMs % 1000) * 1000000L;
+		nanosleep(&pause, NULL);
+	}
+	fds.fd = streamFd;
+	fds.events = POLLIN;
+	if (poll(&fds, 1, inputClosed ? 0 : timeoutMs) <= 0) return FALSE;
+	count = read(streamFd, buffer + buffered, STREAM_BUFFER_SIZE - 1 - buffered);
+	if (count < 0) return FALSE;		// interrupted by a signal
+	inputClosed = (count == 0);			// the writer may come back
+	buffered += (unsigned)count;
+	return completeLine() != NULL;
+}
+
+static char* completeLine(void)
+{	// the end of the first buffered line, NULL if it is incomplete
+	return (char*)memchr(buffer, '\n', buffered);
+}
+
+static void dropLine(char* lineEnd)
+{
+	unsigned length = (unsigned)(lineEnd - buffer) + 1;
+
+	memmove(buffer, buffer + length, buffered - length);
+	buffered -= length;
+}
+
+static double wallOf(unsigned time)
+{	// the wall-clock time at which the paced run reaches the system time
+	return wallBase + (double)(time - simBase) * 1e9 / (STREAM_UNITS_PER_SECOND * paceFactor);
+}
+
+static unsigned simOf(double ns)
+{	// the system time of the paced run at a wall-clock time, never before now
+	unsigned time = simBase + (unsigned)((ns - wallBase) * STREAM_UNITS_PER_SECOND * paceFactor / 1e9);
+
+	return (time > systemTime) ? time : systemTime;
+}
+#endif
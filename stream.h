@@ -0,0 +1,50 @@
+/* Include-file defining the live ingest of a trace and the wall-clock pacing	*/
+/* With followInput the trace (a file, a FIFO or "-" for stdin) is read		*/
+/* without blocking, and EOF only means that no further record is there yet:	*/
+/* the simulation keeps running and waits for new records. The feed starts	*/
+/* with a header line like a trace file and ends with SIGINT or SIGTERM;		*/
+/* records not read by then are dropped, the processes in the system run to	*/
+/* completion and the run ends as usual. A record whose start time has			*/
+/* already passed starts at once.												*/
+/* With paceFactor the simulated time advances with the wall clock,			*/
+/* STREAM_UNITS_PER_SECOND time units per second times the factor, so that a	*/
+/* trace or a feed is replayed at a controlled rate. A record arriving while	*/
+/* the core loop waits is taken at the current paced time.					*/
+/* Only available on POSIX systems.											*/
+#ifndef __STREAM__
+#define __STREAM__
+
+#include "bs_types.h"
+
+#define STREAM_UNITS_PER_SECOND	1000	// time units per second at pace 1
+#define STREAM_POLL_MS			100		// longest wait without checking for the end
+#define STREAM_BUFFER_SIZE		4096	// bytes read ahead of the parser
+
+extern Boolean followInput;		// read the trace as a live feed, FALSE by default
+extern double paceFactor;		// speed against the wall clock, 0 = unpaced
+
+
+Boolean openStream(const char* filename);
+/* opens the trace for following and catches SIGINT and SIGTERM, which end	*/
+/* the feed. Returns FALSE if the trace cannot be opened						*/
+
+Boolean streamReadProcess(PCB_t* pProcess);
+/* takes the next complete record of the feed without blocking and sets		*/
+/* the components stored in the trace. The header line is skipped.			*/
+/* returns FALSE if no complete record is there (yet)						*/
+
+Boolean streamFinished(void);
+/* returns TRUE once the feed was ended by a signal							*/
+
+unsigned streamWait(unsigned delta, SchedulingEvent_t* pEvent);
+/* called by the core loop before it advances the time by delta to the		*/
+/* next event *pEvent. With pacing it waits for the wall-clock time of the	*/
+/* event; while following it waits for the next record instead of running	*/
+/* idle. If a record arrives first, the time up to now is returned and		*/
+/* *pEvent is set to none. Without following and pacing returns delta		*/
+
+void logStreamStatistics(void);
+/* prints the records taken from the feed and how far the run fell behind	*/
+/* the wall clock, only if following or pacing								*/
+
+#endif /* __STREAM__ */
@@ -0,0 +1,225 @@
+/* Implementation of the canonical run summary */
+/* for comments on the functions see the associated .h-file */
+
+/* ---------------------------------------------------------------- */
+/* Include required external definitions */
+#include "globals.h"
+#include "summary.h"
+#include "stats.h"
+#include "checkpoint.h"
+
+/* ----------------------------------------------------------------	*/
+/* Declarations of global variables visible only in this file 		*/
+static unsigned completedCount;		// number of completed processes
+static unsigned rejectedCount;		// number of rejected processes
+static unsigned long long turnaroundTotal;	// sum of all turnaround times
+static unsigned turnaroundMin;		// shortest turnaround time
+static unsigned turnaroundMax;		// longest turnaround time
+static unsigned peakFragmentation;	// external fragmentation in permille
+static unsigned peakFreeBlocks;		// largest number of free blocks seen
+static unsigned partCompactions;	// memory statistics at the start of the part
+static unsigned long long partUnitsMoved;
+static const SummaryPart_t* pGivenTotal = NULL;	// reported instead of the run, see setSummaryTotal()
+
+/* ---------------------------------------------------------------- */
+/*                Externally available functions                    */
+/* ---------------------------------------------------------------- */
+
+void resetSummary(void)
+{
+	completedCount = 0;
+	rejectedCount = 0;
+	turnaroundTotal = 0;
+	turnaroundMin = 0;
+	turnaroundMax = 0;
+	peakFragmentation = 0;
+	peakFreeBlocks = 0;
+	partCompactions = 0;
+	partUnitsMoved = 0;
+	pGivenTotal = NULL;
+}
+
+void summaryProcessCompleted(PCB_t* pProcess)
+{
+	unsigned turnaround = systemTime - pProcess->arrival;
+
+	if ((completedCount == 0) || (turnaround < turnaroundMin)) turnaroundMin = turnaround;
+	if (turnaround > turnaroundMax) turnaroundMax = turnaround;
+	turnaroundTotal += turnaround;
+	completedCount++;
+}
+
+void summaryProcessRejected(void)
+{
+	rejectedCount++;
+}
+
+void summaryMemoryChanged(void)
+{
+	MemoryStats_t stats;
+
+	getStats(&stats);
+	if (stats.fragmentation > peakFragmentation) peakFragmentation = stats.fragmentation;
+	if (stats.freeBlocks > peakFreeBlocks) peakFreeBlocks = stats.freeBlocks;
+}
+
+void takeSummaryPart(SummaryPart_t* pPart)
+{
+	MemoryStats_t stats;
+
+	getStats(&stats);
+	pPart->endTime = systemTime;
+	pPart->completedCount = completedCount;
+	pPart->rejectedCount = rejectedCount;
+	pPart->turnaroundTotal = turnaroundTotal;
+	pPart->turnaroundMin = turnaroundMin;
+	pPart->turnaroundMax = turnaroundMax;
+	pPart->compactions = stats.compactions - partCompactions;
+	pPart->unitsMoved = stats.unitsMoved - partUnitsMoved;
+	pPart->peakFragmentation = peakFragmentation;
+	pPart->peakFreeBlocks = peakFreeBlocks;
+	// the next part starts like a new run, only the memory statistics go on
+	completedCount = 0;
+	rejectedCount = 0;
+	turnaroundTotal = 0;
+	turnaroundMin = 0;
+	turnaroundMax = 0;
+	peakFragmentation = 0;
+	peakFreeBlocks = 0;
+	partCompactions = stats.compactions;
+	partUnitsMoved = stats.unitsMoved;
+}
+
+void addSummaryPart(SummaryPart_t* pTotal, const SummaryPart_t* pPart)
+{
+	if ((pPart->completedCount > 0)
+		&& ((pTotal->completedCount == 0) || (pPart->turnaroundMin < pTotal->turnaroundMin)))
+		pTotal->turnaroundMin = pPart->turnaroundMin;
+	if (pPart->turnaroundMax > pTotal->turnaroundMax) pTotal->turnaroundMax = pPart->turnaroundMax;
+	if (pPart->peakFragmentation > pTotal->peakFragmentation) pTotal->peakFragmentation = pPart->peakFragmentation;
+	if (pPart->peakFreeBlocks > pTotal->peakFreeBlocks) pTotal->peakFreeBlocks = pPart->peakFreeBlocks;
+	pTotal->endTime = pPart->endTime;
+	pTotal->completedCount += pPart->completedCount;
+	pTotal->rejectedCount += pPart->rejectedCount;
+	pTotal->turnaroundTotal += pPart->turnaroundTotal;
+	pTotal->compactions += pPart->compactions;
+	pTotal->unitsMoved += pPart->unitsMoved;
+}
+
+void setSummaryTotal(const SummaryPart_t* pTotal)
+{
+	pGivenTotal = pTotal;
+}
+
+void saveSummaryCheckpoint(Checkpoint_t* pCheckpoint)
+{
+	pCheckpoint->summary.completedCount = completedCount;
+	pCheckpoint->summary.rejectedCount = rejectedCount;
+	pCheckpoint->summary.turnaroundTotal = turnaroundTotal;
+	pCheckpoint->summary.turnaroundMin = turnaroundMin;
+	pCheckpoint->summary.turnaroundMax = turnaroundMax;
+	pCheckpoint->summary.peakFragmentation = peakFragmentation;
+	pCheckpoint->summary.peakFreeBlocks = peakFreeBlocks;
+}
+
+void restoreSummaryCheckpoint(const Checkpoint_t* pCheckpoint)
+{
+	completedCount = pCheckpoint->summary.completedCount;
+	rejectedCount = pCheckpoint->summary.rejectedCount;
+	turnaroundTotal = pCheckpoint->summary.turnaroundTotal;
+	turnaroundMin = pCheckpoint->summary.turnaroundMin;
+	turnaroundMax = pCheckpoint->summary.turnaroundMax;
+	peakFragmentation = pCheckpoint->summary.peakFragmentation;
+	peakFreeBlocks = pCheckpoint->summary.peakFreeBlocks;
+}
+
+int formatSummary(char* buffer, size_t length)
+{
+	MemoryStats_t stats;
+	SummaryPart_t run;
+	const SummaryPart_t* pTotal = pGivenTotal;
+
+	if (pTotal == NULL)
+	{	// the values of the current run
+		getStats(&stats);
+		run.endTime = systemTime;
+		run.completedCount = completedCount;
+		run.rejectedCount = rejectedCount;
+		run.turnaroundTotal = turnaroundTotal;
+		run.turnaroundMin = turnaroundMin;
+		run.turnaroundMax = turnaroundMax;
+		run.compactions = stats.compactions;
+		run.unitsMoved = stats.unitsMoved;
+		run.peakFragmentation = peakFragmentation;
+		run.peakFreeBlocks = peakFreeBlocks;
+		pTotal = &run;
+	}
+	return snprintf(buffer, length,
+		"# memsim summary v%u\n"
+		"seed %u\n"
+		"end_time %u\n"
+		"processes_completed %u\n"
+		"processes_rejected %u\n"
+		"turnaround_total %llu\n"
+		"turnaround_min %u\n"
+		"turnaround_max %u\n"
+		"turnaround_mean %llu\n"
+		"compactions %u\n"
+		"units_moved %llu\n"
+		"peak_fragmentation_permille %u\n"
+		"peak_free_blocks %u\n",
+		SUMMARY_VERSION, simSeed, pTotal->endTime, pTotal->completedCount, pTotal->rejectedCount,
+		pTotal->turnaroundTotal, pTotal->turnaroundMin, pTotal->turnaroundMax,
+		(pTotal->completedCount > 0) ? pTotal->turnaroundTotal / pTotal->completedCount : 0ULL,
+		pTotal->compactions, pTotal->unitsMoved, pTotal->peakFragmentation, pTotal->peakFreeBlocks);
+}
+
+void writeSummary(FILE* f)
+{
+	char buffer[SUMMARY_BUFFER_SIZE];
+
+	formatSummary(buffer, sizeof(buffer));
+	fputs(buffer, f);
+}
+
+Boolean compareSummaryWithGolden(const char* goldenFilename)
+{
+	char current[SUMMARY_BUFFER_SIZE];
+	char goldenLine[129];
+	char* currentLine;
+	char* lineEnd;
+	unsigned lineNo = 0;
+	Boolean identical = TRUE;
+	FILE* golden;
+
+	golden = fopen(goldenFilename, "r");
+	if (golden == NULL)
+	{
+		printf("Regression: cannot open golden summary %s\n", goldenFilename);
+		return FALSE;
+	}
+	formatSummary(current, sizeof(current));
+	currentLine = current;
+	while (*currentLine != '\0')
+	{	// compare line by line, both sides are terminated by '\n'
+		lineEnd = strchr(currentLine, '\n');
+		*lineEnd = '\0';
+		lineNo++;
+		if (fgets(goldenLine, sizeof(goldenLine), golden) == NULL) goldenLine[0] = '\0';
+		goldenLine[strcspn(goldenLine, "\r\n")] = '\0';
+		if (strcmp(currentLine, goldenLine) != 0)
+		{
+			printf("Regression: %s line %u: expected \"%s\", got \"%s\"\n",
+				goldenFilename, lineNo, goldenLine, currentLine);
+			identical = FALSE;
+		}
+		currentLine = lineEnd + 1;
+	}
+	if (fgets(goldenLine, sizeof(goldenLine), golden) != NULL)
+	{
+		printf("Regression: %s has more lines than the current summary\n", goldenFilename);
+		identical = FALSE;
+	}
+	fclose(golden);
+	return identical;
+}
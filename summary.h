@@ -0,0 +1,81 @@
+/* Include-file defining the canonical run summary of the simulation		*/
+/* The summary condenses one run into a fixed set of integer key/value		*/
+/* lines so that runs can be diffed and compared against stored golden		*/
+/* summaries (regression mode). The seed line records --seed, which is		*/
+/* reserved: no part of the model draws random numbers yet, so runs with	*/
+/* different seeds only differ in that line.								*/
+#ifndef __SUMMARY__
+#define __SUMMARY__
+
+#include <stdio.h>
+#include "bs_types.h"
+
+// version tag written into the first line of every summary
+#define SUMMARY_VERSION 1
+
+// maximum length of a formatted summary
+#define SUMMARY_BUFFER_SIZE 1024
+
+/* data type of the summary values of a part of a run, see takeSummaryPart() */
+typedef struct
+	{
+		unsigned endTime;				// systemTime at the end of the part
+		unsigned completedCount;
+		unsigned rejectedCount;
+		unsigned long long turnaroundTotal;
+		unsigned turnaroundMin;			// only valid if completedCount > 0
+		unsigned turnaroundMax;
+		unsigned compactions;
+		unsigned long long unitsMoved;
+		unsigned peakFragmentation;
+		unsigned peakFreeBlocks;
+	} SummaryPart_t;
+
+
+void resetSummary(void);
+/* clears all values collected for the summary, called at start of a run	*/
+
+void summaryProcessCompleted(PCB_t* pProcess);
+/* records the turnaround time (systemTime - arrival) of a process that		*/
+/* just completed. Must be called before the PCB is deleted.				*/
+
+void summaryProcessRejected(void);
+/* records a process that was rejected because it can never fit in memory	*/
+
+void summaryMemoryChanged(void);
+/* samples the memory statistics and updates the peak fragmentation values	*/
+/* to be called after every change of the free list							*/
+
+void takeSummaryPart(SummaryPart_t* pPart);
+/* returns the values collected since the previous call and starts a new	*/
+/* part. The first call after a restore returns the whole run up to it.		*/
+/* A run cut into parts is put together again by addSummaryPart()			*/
+
+void addSummaryPart(SummaryPart_t* pTotal, const SummaryPart_t* pPart);
+/* adds the following part of a run to pTotal, which starts zeroed			*/
+
+void setSummaryTotal(const SummaryPart_t* pTotal);
+/* makes the summary report the given values instead of those of the		*/
+/* current run, until the next resetSummary()								*/
+
+struct Checkpoint;
+
+void saveSummaryCheckpoint(struct Checkpoint* pCheckpoint);
+/* stores the values collected for the summary								*/
+
+void restoreSummaryCheckpoint(const struct Checkpoint* pCheckpoint);
+/* restores the values collected for the summary							*/
+
+int formatSummary(char* buffer, size_t length);
+/* writes the canonical summary into buffer, one "key value" pair per line	*/
+/* returns the number of characters written, negative on error				*/
+
+void writeSummary(FILE* f);
+/* writes the canonical summary to the given file handle					*/
+
+Boolean compareSummaryWithGolden(const char* goldenFilename);
+/* compares the summary of the current run with the stored golden summary	*/
+/* every differing line is reported on stdout								*/
+/* returns TRUE if both are identical, FALSE on difference or read error	*/
+
+#endif /* __SUMMARY__ */
@@ -0,0 +1,297 @@
+/* Synthetic workload generator for the memory manager simulation		*/
+/* Writes process traces in the format read by the loader:				*/
+/*		<ownerID> <start> <duration> <size> <type>						*/
+/* Lines are generated and written one at a time, so traces of any		*/
+/* length can be produced in constant memory.							*/
+/* Distributions are given as <kind>:<p1>[:<p2>[:<p3>]]					*/
+/*		const:V					always V								*/
+/*		uniform:MIN:MAX			uniformly distributed in [MIN, MAX]		*/
+/*		exp:MEAN				exponentially distributed				*/
+/*		lognormal:MEDIAN:SIGMA	log-normal, SIGMA of the underlying normal */
+/*		bimodal:SMALL:LARGE:P	SMALL with probability P, LARGE otherwise,	*/
+/*								each varied by +-25%					*/
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include <limits.h>
+
+#define NUM_TYPES 5			// number of process types of ProcessType_t
+#define OUTPUT_BUFFER_SIZE (1 << 20)
+
+typedef enum { distConst, distUniform, distExp, distLognormal, distBimodal } DistKind_t;
+
+typedef struct
+	{
+		DistKind_t kind;
+		double p1, p2, p3;
+	} Distribution_t;
+
+typedef enum { arrivalPoisson, arrivalBursty } ArrivalKind_t;
+
+
+/* ----------------------------------------------------------------	*/
+/* Declarations of global variables visible only in this file 		*/
+static const char* typeNames[NUM_TYPES] = { "os", "interactive", "batch", "background", "foreground" };
+static unsigned long long rngState = 88172645463325252ULL;	// xorshift64* state
+static unsigned long long processCount = 1000;			// --count
+static ArrivalKind_t arrivalKind = arrivalPoisson;		// --arrival
+static double arrivalRate = 0.01;						// --rate, arrivals per time unit
+static double burstMean = 8.0;							// --burst, mean arrivals per burst
+static unsigned ownerCount = 10;						// --owners
+static double typeWeight[NUM_TYPES] = { 1.0, 2.0, 3.0, 1.0, 3.0 };	// --mix
+static Distribution_t sizeDist[NUM_TYPES];				// --size, --type-size
+static Distribution_t durationDist[NUM_TYPES];			// --duration, --type-duration
+static unsigned maxSize = 0;							// --max-size, 0 = unlimited
+
+/* ---------------------------------------------------------------- */
+/*                Declarations of local functions                   */
+static double uniform01(void);
+static double normal01(void);
+static double sample(const Distribution_t* d);
+static int parseDistribution(const char* text, Distribution_t* d);
+static int parseMix(const char* text);
+static int typeFromName(const char* name, size_t length);
+static int parseTypeDistribution(const char* text, Distribution_t* table);
+static void printUsage(const char* program);
+
+
+int main(int argc, char* argv[])
+{
+	const char* outputName = NULL;
+	FILE* out = stdout;
+	Distribution_t d;
+	double now = 0.0, totalWeight, pick;
+	unsigned long long i, burstLeft = 0;
+	unsigned t, start, size, duration;
+	int a;
+
+	for (t = 0; t < NUM_TYPES; t++)
+	{	// defaults resemble processes.txt
+		parseDistribution("bimodal:16:220:0.3", &sizeDist[t]);
+		parseDistribution("uniform:100:700", &durationDist[t]);
+	}
+	for (a = 1; a < argc; a++)
+	{
+		int ok = (a + 1 < argc);
+		if (ok && strcmp(argv[a], "--count") == 0) processCount = strtoull(argv[++a], NULL, 10);
+		else if (ok && strcmp(argv[a], "--seed") == 0)
+		{
+			rngState = strtoull(argv[++a], NULL, 10) * 2685821657736338717ULL + 1;
+		}
+		else if (ok && strcmp(argv[a], "--arrival") == 0)
+		{
+			a++;
+			if (strcmp(argv[a], "poisson") == 0) arrivalKind = arrivalPoisson;
+			else if (strcmp(argv[a], "bursty") == 0) arrivalKind = arrivalBursty;
+			else ok = 0;
+		}
+		else if (ok && strcmp(argv[a], "--rate") == 0) arrivalRate = atof(argv[++a]);
+		else if (ok && strcmp(argv[a], "--burst") == 0) burstMean = atof(argv[++a]);
+		else if (ok && strcmp(argv[a], "--owners") == 0) ownerCount = (unsigned)strtoul(argv[++a], NULL, 10);
+		else if (ok && strcmp(argv[a], "--mix") == 0) ok = parseMix(argv[++a]);
+		else if (ok && strcmp(argv[a], "--size") == 0)
+		{
+			ok = parseDistribution(argv[++a], &d);
+			for (t = 0; t < NUM_TYPES; t++) sizeDist[t] = d;
+		}
+		else if (ok && strcmp(argv[a], "--duration") == 0)
+		{
+			ok = parseDistribution(argv[++a], &d);
+			for (t = 0; t < NUM_TYPES; t++) durationDist[t] = d;
+		}
+		else if (ok && strcmp(argv[a], "--type-size") == 0) ok = parseTypeDistribution(argv[++a], sizeDist);
+		else if (ok && strcmp(argv[a], "--type-duration") == 0) ok = parseTypeDistribution(argv[++a], durationDist);
+		else if (ok && strcmp(argv[a], "--max-size") == 0) maxSize = (unsigned)strtoul(argv[++a], NULL, 10);
+		else if (ok && strcmp(argv[a], "--output") == 0) outputName = argv[++a];
+		else ok = 0;
+		if (!ok)
+		{
+			fprintf(stderr, "Invalid or incomplete option: %s\n", argv[a]);
+			printUsage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if ((arrivalRate <= 0.0) || (burstMean < 1.0) || (ownerCount == 0))
+	{
+		fprintf(stderr, "--rate must be positive, --burst at least 1 and --owners at least 1\n");
+		return EXIT_FAILURE;
+	}
+	for (t = 0, totalWeight = 0.0; t < NUM_TYPES; t++) totalWeight += typeWeight[t];
+	if (totalWeight <= 0.0)
+	{
+		fprintf(stderr, "--mix needs at least one positive weight\n");
+		return EXIT_FAILURE;
+	}
+	if (outputName != NULL)
+	{
+		out = fopen(outputName, "w");
+		if (out == NULL)
+		{
+			fprintf(stderr, "Cannot open %s for writing\n", outputName);
+			return EXIT_FAILURE;
+		}
+	}
+	setvbuf(out, NULL, _IOFBF, OUTPUT_BUFFER_SIZE);
+
+	fprintf(out, " # OwnerID start duration size type\n");
+	for (i = 0; i < processCount; i++)
+	{
+		// arrival process
+		if (arrivalKind == arrivalPoisson)
+			now += -log(1.0 - uniform01()) / arrivalRate;
+		else if (burstLeft == 0)
+		{	// bursts arrive as a Poisson process, all members at the same time,
+			// burst sizes are geometric, so the long term rate stays arrivalRate
+			now += -log(1.0 - uniform01()) * burstMean / arrivalRate;
+			burstLeft = 1 + (unsigned long long)floor(log(1.0 - uniform01()) / log(1.0 - 1.0 / burstMean));
+		}
+		if (burstLeft > 0) burstLeft--;
+		if (now > (double)UINT_MAX)
+		{
+			fprintf(stderr, "Start times exceed the 32 bit range after %llu processes, stopping\n", i);
+			break;
+		}
+		start = (unsigned)now;
+
+		// process type from the mix
+		pick = uniform01() * totalWeight;
+		for (t = 0; t < NUM_TYPES - 1; t++)
+		{
+			if (pick < typeWeight[t]) break;
+			pick -= typeWeight[t];
+		}
+		while (typeWeight[t] <= 0.0) t--;	// rounding at the upper end
+
+		size = (unsigned)(sample(&sizeDist[t]) + 0.5);
+		if (size == 0) size = 1;
+		if ((maxSize > 0) && (size > maxSize)) size = maxSize;
+		duration = (unsigned)(sample(&durationDist[t]) + 0.5);
+		if (duration == 0) duration = 1;
+
+		fprintf(out, " %02u %u %u %u %s\n", (unsigned)(uniform01() * ownerCount),
+			start, duration, size, typeNames[t]);
+	}
+	if (out != stdout) fclose(out);
+	else fflush(out);
+	return EXIT_SUCCESS;
+}
+
+/* ---------------------------------------------------------------- */
+/*                Implementation of local functions                 */
+
+static double uniform01(void)
+{	// xorshift64*, uniformly distributed in [0, 1)
+	rngState ^= rngState >> 12;
+	rngState ^= rngState << 25;
+	rngState ^= rngState >> 27;
+	return (double)((rngState * 2685821657736338717ULL) >> 11) / 9007199254740992.0;
+}
+
+static double normal01(void)
+{	// standard normal distribution by the Box-Muller transform
+	double u1 = 1.0 - uniform01(), u2 = uniform01();
+	return sqrt(-2.0 * log(u1)) * cos(6.283185307179586 * u2);
+}
+
+static double sample(const Distribution_t* d)
+{
+	double v = 0.0;
+
+	switch (d->kind) {
+		case distConst:
+			v = d->p1;
+			break;
+		case distUniform:
+			v = d->p1 + uniform01() * (d->p2 - d->p1);
+			break;
+		case distExp:
+			v = -log(1.0 - uniform01()) * d->p1;
+			break;
+		case distLognormal:
+			v = d->p1 * exp(d->p2 * normal01());
+			break;
+		case distBimodal:
+			v = (uniform01() < d->p3) ? d->p1 : d->p2;
+			v *= 0.75 + 0.5 * uniform01();
+			break;
+	}
+	return (v < 0.0) ? 0.0 : v;
+}
+
+static int parseDistribution(const char* text, Distribution_t* d)
+{	// returns 1 on success, 0 on a malformed distribution
+	char kind[16] = "";
+	int n;
+
+	d->p1 = d->p2 = d->p3 = 0.0;
+	n = sscanf(text, "%15[a-z]:%lf:%lf:%lf", kind, &d->p1, &d->p2, &d->p3);
+	if ((strcmp(kind, "const") == 0) && (n == 2)) d->kind = distConst;
+	else if ((strcmp(kind, "uniform") == 0) && (n == 3)) d->kind = distUniform;
+	else if ((strcmp(kind, "exp") == 0) && (n == 2)) d->kind = distExp;
+	else if ((strcmp(kind, "lognormal") == 0) && (n == 3)) d->kind = distLognormal;
+	else if ((strcmp(kind, "bimodal") == 0) && (n == 4)) d->kind = distBimodal;
+	else return 0;
+	return 1;
+}
+
+static int typeFromName(const char* name, size_t length)
+{
+	int t;
+
+	for (t = 0; t < NUM_TYPES; t++)
+		if ((strlen(typeNames[t]) == length) && (strncmp(typeNames[t], name, length) == 0)) return t;
+	return -1;
+}
+
+static int parseMix(const char* text)
+{	// comma separated list of <type>=<weight>, unlisted types get weight 0
+	const char* p = text;
+	const char* eq;
+	int t;
+
+	for (t = 0; t < NUM_TYPES; t++) typeWeight[t] = 0.0;
+	while (*p != '\0')
+	{
+		eq = strchr(p, '=');
+		if (eq == NULL) return 0;
+		t = typeFromName(p, (size_t)(eq - p));
+		if (t < 0) return 0;
+		typeWeight[t] = atof(eq + 1);
+		p = strchr(eq, ',');
+		if (p == NULL) break;
+		p++;
+	}
+	return 1;
+}
+
+static int parseTypeDistribution(const char* text, Distribution_t* table)
+{	// <type>=<distribution>
+	const char* eq = strchr(text, '=');
+	int t;
+
+	if (eq == NULL) return 0;
+	t = typeFromName(text, (size_t)(eq - text));
+	if (t < 0) return 0;
+	return parseDistribution(eq + 1, &table[t]);
+}
+
+static void printUsage(const char* program)
+{
+	printf("Usage: %s [options]\n", program);
+	printf("  --count N              number of processes (default 1000)\n");
+	printf("  --seed N               seed of the generator\n");
+	printf("  --arrival poisson|bursty  arrival process (default poisson)\n");
+	printf("  --rate R               mean arrivals per time unit (default 0.01)\n");
+	printf("  --burst B              bursty: mean number of processes per burst (default 8)\n");
+	printf("  --owners N             owner IDs are drawn from 0..N-1 (default 10)\n");
+	printf("  --mix T=W,...          weights of the process types (default os=1,interactive=2,\n");
+	printf("                         batch=3,background=1,foreground=3)\n");
+	printf("  --size DIST            size distribution of all types (default bimodal:16:220:0.3)\n");
+	printf("  --duration DIST        duration distribution of all types (default uniform:100:700)\n");
+	printf("  --type-size T=DIST     size distribution of one type\n");
+	printf("  --type-duration T=DIST duration distribution of one type\n");
+	printf("  --max-size N           clamp sizes to N\n");
+	printf("  --output FILE          write to FILE instead of stdout\n");
+	printf("DIST: const:V | uniform:MIN:MAX | exp:MEAN | lognormal:MEDIAN:SIGMA | bimodal:SMALL:LARGE:P\n");
+}